@@ -39,7 +39,12 @@ VIVADO_DSN_VHDL_2008:=\
 	$(SRC)/common/basic/fifo_pkg.vhd \
 	$(SRC)/common/axi/axi4_a32d32_srw32.vhd \
 	$(CSR_RA_VHD) \
+	$(SRC)/designs/$(DESIGN)/$(DESIGN)_dec.vhd \
+	$(SRC)/designs/$(DESIGN)/$(DESIGN)_vtm.vhd \
+	$(SRC)/designs/$(DESIGN)/$(DESIGN)_crc.vhd \
 	$(SRC)/designs/$(DESIGN)/$(DESIGN)_csr.vhd \
+	$(SRC)/designs/$(DESIGN)/$(DESIGN)_trig.vhd \
+	$(SRC)/designs/$(DESIGN)/$(DESIGN)_pkt.vhd \
 	$(SRC)/designs/$(DESIGN)/$(DESIGN)_stream.vhd \
 	$(SRC)/designs/$(DESIGN)/$(FPGA_VENDOR)/$(FPGA_FAMILY)/$(DESIGN)_io.vhd \
 	$(SRC)/common/i2c/i2c_rep_uni.vhd \
@@ -80,6 +85,12 @@ VITIS_SRC=\
 	$(VITIS_SRC_DIR)/z7ps/hal.h \
 	$(VITIS_SRC_DIR)/z7ps/hal.c
 VITIS_INCLUDE=$(VITIS_SRC_DIR)/z7ps
+# CAP_ACP=1: capture DMA through the ACP (cache coherent) rather than HP0
+CAP_ACP?=0
+export CAP_ACP
+ifeq (1,$(CAP_ACP))
+VITIS_SYMBOL+=CAP_ACP
+endif
 endif
 VITIS_APP:=$(DESIGN)
 VITIS_SRC+=\
@@ -93,6 +104,9 @@ VITIS_SRC+=\
 	$(VITIS_SRC_DIR)/sdram.h \
 	$(VITIS_SRC_DIR)/cap.c \
 	$(VITIS_SRC_DIR)/cap.h \
+	$(VITIS_SRC_DIR)/rle.c \
+	$(VITIS_SRC_DIR)/rle.h \
+	$(VITIS_SRC_DIR)/proto.h \
 	$(VITIS_SRC_DIR)/server.c \
 	$(VITIS_SRC_DIR)/server.h \
 	$(VITIS_SRC_DIR)/main.c
@@ -100,7 +114,8 @@ VITIS_INCLUDE+=$(VITIS_SRC_DIR) $(GEN)
 VITIS_BSP_LIB:=lwip213
 VITIS_BSP_CFG:=\
 	no_sys_no_timers:false \
-	lwip_dhcp:true
+	lwip_dhcp:true \
+	memp_n_pbuf:256
 
 VSCODE_TOP:=$(VIVADO_DSN_TOP),$(VIVADO_SIM_TOP)
 VSCODE_SRC:=$(VIVADO_DSN_VHDL_2008)
@@ -128,4 +143,4 @@ $(GEN_DIR):
 	bash -c "mkdir -p $@"
 
 $(CSR_RA_VHD) $(CSR_RA_H): $(CSR_RA_CSV) | $(GEN_DIR)
-	python $(CSR_RA_PY) 8 $(CSR_RA_CSV) $(CSR_RA_VHD) $(CSR_RA_H)
+	python $(CSR_RA_PY) 12 $(CSR_RA_CSV) $(CSR_RA_VHD) $(CSR_RA_H)
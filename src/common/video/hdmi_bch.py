@@ -0,0 +1,100 @@
+################################################################################
+## hdmi_bch.py                                                                ##
+## HDMI BCH ECC: table driven check and single bit correction.               ##
+################################################################################
+## (C) Copyright 2023 Adam Barnes <ambarnes@gmail.com>                        ##
+##                                                                            ##
+## This file is part of The Tyto Project. The Tyto Project is free software:  ##
+## you can redistribute it and/or modify it under the terms of the GNU Lesser ##
+## General Public License as published by the Free Software Foundation,       ##
+## either version 3 of the License, or (at your option) any later version.    ##
+## The Tyto Project is distributed in the hope that it will be useful, but    ##
+## WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY ##
+## or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public     ##
+## License for more details. You should have received a copy of the GNU       ##
+## Lesser General Public License along with The Tyto Project. If not, see     ##
+## https://www.gnu.org/licenses/.                                             ##
+# HDMI data island packets carry 5 BCH blocks: the header, BCH(32,24), and
+# 4 subpackets, BCH(64,56); the last byte of each block is its ECC. The ECC
+# is made by an 8 bit LFSR (see HDMI 1.4b fig 5-5) clocked once per bit, LSB
+# first. clock() is that LFSR; it is linear, so 8 clocks of it reduce to a
+# 256 entry table indexed by (state XOR data byte), and the ECC of a block
+# takes one lookup per byte.
+# A block whose recomputed ECC differs from the one received has a nonzero
+# syndrome (their XOR). Each single bit error gives a different syndrome, so
+# a syndrome table locates (and the checker corrects) any single bit error;
+# other syndromes mean an uncorrectable error.
+# hdmi_bch_ecc.py derives the LFSR logic equations for the HDL from clock().
+
+# one clock of the LFSR: state q, data bit d; return new state
+def clock(q,d):
+    fb = (q ^ d) & 1
+    return (q >> 1) ^ (fb*0b10000011) # q0 <= q1^fb, q1 <= q2^fb, q7 <= fb
+
+# ECC state after one byte, indexed by (state XOR byte)
+TABLE = []
+for x in range(256):
+    q = x
+    for i in range(8):
+        q = clock(q,0)
+    TABLE.append(q)
+
+# ECC of bytes
+def ecc(data):
+    q = 0
+    for b in data:
+        q = TABLE[q ^ b]
+    return q
+
+# syndrome of a block (data bytes then ECC byte): 0 if no error
+def syndrome(block):
+    return ecc(block[:-1]) ^ block[-1]
+
+# syndrome table for blocks of n bytes: syndrome => position of bit in error
+# (8 x byte + bit)
+def syndromes(n):
+    t = {}
+    for i in range(8*n):
+        e = [0]*n
+        e[i//8] = 1 << (i%8)
+        t[syndrome(e)] = i
+    assert len(t) == 8*n # every single bit error is distinguishable
+    return t
+
+HB_BYTES = 4 # header block: 3 data bytes + ECC
+SB_BYTES = 8 # subpacket block: 7 data bytes + ECC
+SYNDROMES = {HB_BYTES: syndromes(HB_BYTES),SB_BYTES: syndromes(SB_BYTES)}
+
+# check result
+OK            = 0
+CORRECTED     = 1 # single bit error, corrected
+UNCORRECTABLE = 2
+
+# checks blocks, corrects single bit errors, and keeps statistics
+class Checker:
+    def __init__(self):
+        self.blocks = 0
+        self.corrected = 0
+        self.uncorrectable = 0
+        self.bits = {} # corrections per bit position, keyed by (block bytes, bit)
+
+    # check block (bytes, bytearray or memoryview of HB_BYTES or SB_BYTES
+    # bytes), correct it in place if possible; return (result, bit corrected)
+    def check(self,block):
+        self.blocks += 1
+        s = syndrome(block)
+        if not s:
+            return OK,None
+        i = SYNDROMES[len(block)].get(s)
+        if i is None:
+            self.uncorrectable += 1
+            return UNCORRECTABLE,None
+        block[i//8] ^= 1 << (i%8)
+        self.corrected += 1
+        k = (len(block),i)
+        self.bits[k] = self.bits.get(k,0)+1
+        return CORRECTED,i
+
+    def summary(self):
+        return "%d BCH blocks checked: %d corrected (single bit), %d uncorrectable" % \
+            (self.blocks,self.corrected,self.uncorrectable)
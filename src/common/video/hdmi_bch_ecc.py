@@ -16,37 +16,37 @@
 ## https://www.gnu.org/licenses/.                                             ##
 ################################################################################
 
-# initial states
-reg_q = []
-reg_d = []
-for i in range (0,8):
-    reg_q.append(["q"+str(i)])
-    reg_d.append([])
+# Each output of the LFSR after k clocks is the XOR of some of its initial
+# state bits (q) and data bits (d); the LFSR is linear, so these are found by
+# clocking it (see hdmi_bch.py) from each single bit.
 
-# 8 cycles through lfsr (see fig 5-5)
-for i in range(0,8):
-    # advance lfsr
-    fb = reg_q[0]+["d"+str(i)]
-    reg_d[0] = reg_q[1]+fb
-    reg_d[1] = reg_q[2]+fb
-    reg_d[2:7] = reg_q[3:8]
-    reg_d[7] = fb
-    reg_q = reg_d
-    # remove all duplicate pairs
-    for j in range(0,8):
-        for k in range(0,8):
-            while reg_q[j].count("q"+str(k)) > 1:
-                reg_q[j].remove("q"+str(k))
-                reg_q[j].remove("q"+str(k))
-            while reg_q[j].count("d"+str(k)) > 1:
-                reg_q[j].remove("d"+str(k))
-                reg_q[j].remove("d"+str(k))    
+import hdmi_bch
+
+# state after clocking data bits d (list) through the LFSR from state q
+def run(q,d):
+    for bit in d:
+        q = hdmi_bch.clock(q,bit)
+    return q
+
+for k in range(1,9):
+    # terms of each output (initial state bits, then data bits)
+    terms = [[] for j in range(8)]
+    for i in range(8):
+        q = run(1 << i,[0]*k)
+        for j in range(8):
+            if (q >> j) & 1:
+                terms[j].append("q"+str(i))
+    for i in range(k):
+        q = run(0,[1 if m == i else 0 for m in range(k)])
+        for j in range(8):
+            if (q >> j) & 1:
+                terms[j].append("d"+str(i))
     # result
-    print("after %d clocks:" % (i+1))
-    for i in range(0,8):
-        reg_q[i].sort()
-        print("q%d <= xor( " % i, end="")
-        for s in reg_q[i]:
-            print(s+" ",end="")
+    print("after %d clocks:" % k)
+    for j in range(8):
+        terms[j].sort()
+        print("q%d <= xor( " % j, end="")
+        for t in terms[j]:
+            print(t+" ",end="")
         print(")")
     print("")
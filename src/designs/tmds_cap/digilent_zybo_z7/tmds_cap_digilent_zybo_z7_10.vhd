@@ -125,6 +125,7 @@ architecture synth of tmds_cap_digilent_zybo_z7_10 is
   signal axi4_miso  : axi4_a32d32_h_miso_t;
   signal axi4s_mosi : axi4s_64_mosi_t;
   signal axi4s_miso : axi4s_64_miso_t;
+  signal cap_irq    : std_logic;
 
   signal gpo        : std_logic_vector(7 downto 0);
   signal gpi        : std_logic_vector(7 downto 0);
@@ -154,7 +155,8 @@ begin
       maxi4_mosi  => axi4_mosi,
       maxi4_miso  => axi4_miso,
       saxi4s_mosi => axi4s_mosi,
-      saxi4s_miso => axi4s_miso
+      saxi4s_miso => axi4s_miso,
+      cap_irq     => cap_irq
     );
 
   -- I/O
@@ -170,6 +172,7 @@ begin
       saxi4_miso    => axi4_miso,
       maxi4s_mosi   => axi4s_mosi,
       maxi4s_miso   => axi4s_miso,
+      cap_irq       => cap_irq,
       hdmi_rx_clk_p => hdmi_rx_clk_p,
       hdmi_rx_clk_n => hdmi_rx_clk_n,
       hdmi_rx_d_p   => hdmi_rx_d_p,
@@ -38,6 +38,20 @@ set current_vivado_version [version -short]
 # To test this script, run the following commands from Vivado Tcl console:
 # source tmds_cap_z7ps_sys_script.tcl
 
+# Capture DMA writes to DDR through HP0 (default), or through the ACP
+# (coherent with the CPU caches) if the environment variable CAP_ACP is 1.
+variable cap_acp
+variable cap_port
+variable cap_seg
+set cap_acp [expr {[info exists ::env(CAP_ACP)] && $::env(CAP_ACP) == 1}]
+if { $cap_acp } {
+  set cap_port S_AXI_ACP
+  set cap_seg ACP_DDR_LOWOCM
+} else {
+  set cap_port S_AXI_HP0
+  set cap_seg HP0_DDR_LOWOCM
+}
+
 # If there is no project opened, this script will create a
 # project, but make sure you do not have an existing project
 # <./myproj/project_1.xpr> in the current working folder.
@@ -128,6 +142,7 @@ xilinx.com:ip:axi_dma:7.1\
 xilinx.com:ip:proc_sys_reset:5.0\
 xilinx.com:ip:processing_system7:5.5\
 xilinx.com:ip:smartconnect:1.0\
+xilinx.com:ip:xlconcat:2.1\
 "
 
    set list_ips_missing ""
@@ -164,6 +179,9 @@ proc create_root_design { parentCell } {
 
   variable script_folder
   variable design_name
+  variable cap_acp
+  variable cap_port
+  variable cap_seg
 
   if { $parentCell eq "" } {
      set parentCell [get_bd_cells /]
@@ -219,15 +237,20 @@ proc create_root_design { parentCell } {
    CONFIG.ASSOCIATED_RESET {axi_rst_n} \
  ] $axi_clk
   set axi_rst_n [ create_bd_port -dir O -from 0 -to 0 -type rst axi_rst_n ]
+  set cap_irq [ create_bd_port -dir I -type intr cap_irq ]
+  set_property -dict [ list \
+   CONFIG.SENSITIVITY {LEVEL_HIGH} \
+ ] $cap_irq
 
   # Create instance: axi_dma, and set properties
   set axi_dma [ create_bd_cell -type ip -vlnv xilinx.com:ip:axi_dma:7.1 axi_dma ]
   set_property -dict [list \
     CONFIG.c_include_mm2s {0} \
-    CONFIG.c_include_sg {0} \
+    CONFIG.c_include_sg {1} \
     CONFIG.c_m_axi_s2mm_data_width {64} \
     CONFIG.c_s2mm_burst_size {256} \
     CONFIG.c_s_axis_s2mm_tdata_width {64} \
+    CONFIG.c_sg_include_stscntrl_strm {0} \
     CONFIG.c_sg_length_width {26} \
   ] $axi_dma
 
@@ -369,6 +392,7 @@ proc create_root_design { parentCell } {
     CONFIG.PCW_I2C_RESET_ENABLE {1} \
     CONFIG.PCW_I2C_RESET_POLARITY {Active Low} \
     CONFIG.PCW_IMPORT_BOARD_PRESET {C:/devtools/Xilinx/Vivado/2023.1/data/boards/board_files/zybo-z7-20/A.0/preset.xml} \
+    CONFIG.PCW_IRQ_F2P_INTR {1} \
     CONFIG.PCW_IRQ_F2P_MODE {DIRECT} \
     CONFIG.PCW_MIO_0_IOTYPE {LVCMOS 3.3V} \
     CONFIG.PCW_MIO_0_PULLUP {enabled} \
@@ -707,6 +731,7 @@ proc create_root_design { parentCell } {
     CONFIG.PCW_USB_RESET_SELECT {Share reset pin} \
     CONFIG.PCW_USE_AXI_NONSECURE {0} \
     CONFIG.PCW_USE_CROSS_TRIGGER {0} \
+    CONFIG.PCW_USE_FABRIC_INTERRUPT {1} \
     CONFIG.PCW_USE_M_AXI_GP0 {1} \
     CONFIG.PCW_USE_M_AXI_GP1 {0} \
     CONFIG.PCW_USE_S_AXI_HP0 {1} \
@@ -714,6 +739,14 @@ proc create_root_design { parentCell } {
     CONFIG.PCW_WDT_PERIPHERAL_DIVISOR0 {1} \
     CONFIG.PCW_WDT_PERIPHERAL_ENABLE {0} \
   ] $z7ps
+  if { $cap_acp } {
+    # ACP replaces HP0; AxUSER is driven so that DMA writes are coherent
+    set_property -dict [list \
+      CONFIG.PCW_USE_S_AXI_ACP {1} \
+      CONFIG.PCW_USE_DEFAULT_ACP_USER_VAL {1} \
+      CONFIG.PCW_USE_S_AXI_HP0 {0} \
+    ] $z7ps
+  }
 
 
   # Create instance: smartconnect32, and set properties
@@ -728,25 +761,34 @@ proc create_root_design { parentCell } {
   set smartconnect64 [ create_bd_cell -type ip -vlnv xilinx.com:ip:smartconnect:1.0 smartconnect64 ]
   set_property -dict [list \
     CONFIG.HAS_ARESETN {1} \
-    CONFIG.NUM_SI {1} \
+    CONFIG.NUM_SI {2} \
   ] $smartconnect64
 
+  # Create instance: irq_concat, and set properties
+  set irq_concat [ create_bd_cell -type ip -vlnv xilinx.com:ip:xlconcat:2.1 irq_concat ]
+  set_property CONFIG.NUM_PORTS {2} $irq_concat
+
 
   # Create interface connections
   connect_bd_intf_net -intf_net S_AXIS_S2MM_0_1 [get_bd_intf_ports saxis64] [get_bd_intf_pins axi_dma/S_AXIS_S2MM]
   connect_bd_intf_net -intf_net axi_dma_M_AXI_S2MM [get_bd_intf_pins axi_dma/M_AXI_S2MM] [get_bd_intf_pins smartconnect64/S00_AXI]
+  connect_bd_intf_net -intf_net axi_dma_M_AXI_SG [get_bd_intf_pins axi_dma/M_AXI_SG] [get_bd_intf_pins smartconnect64/S01_AXI]
   connect_bd_intf_net -intf_net processing_system7_0_M_AXI_GP0 [get_bd_intf_pins z7ps/M_AXI_GP0] [get_bd_intf_pins smartconnect32/S00_AXI]
-  connect_bd_intf_net -intf_net smartconnect64_M00_AXI [get_bd_intf_pins smartconnect64/M00_AXI] [get_bd_intf_pins z7ps/S_AXI_HP0]
+  connect_bd_intf_net -intf_net smartconnect64_M00_AXI [get_bd_intf_pins smartconnect64/M00_AXI] [get_bd_intf_pins z7ps/$cap_port]
   connect_bd_intf_net -intf_net smartconnect_M00_AXI [get_bd_intf_pins smartconnect32/M00_AXI] [get_bd_intf_pins axi_dma/S_AXI_LITE]
   connect_bd_intf_net -intf_net smartconnect_M01_AXI [get_bd_intf_ports maxi32] [get_bd_intf_pins smartconnect32/M01_AXI]
 
   # Create port connections
+  connect_bd_net -net axi_dma_s2mm_introut [get_bd_pins axi_dma/s2mm_introut] [get_bd_pins irq_concat/In0]
+  connect_bd_net -net cap_irq_1 [get_bd_ports cap_irq] [get_bd_pins irq_concat/In1]
+  connect_bd_net -net irq_concat_dout [get_bd_pins irq_concat/dout] [get_bd_pins z7ps/IRQ_F2P]
   connect_bd_net -net processing_system7_0_FCLK_RESET0_N [get_bd_pins z7ps/FCLK_RESET0_N] [get_bd_pins ps_reset/ext_reset_in]
-  connect_bd_net -net z7ps_FCLK_CLK0 [get_bd_pins z7ps/FCLK_CLK0] [get_bd_ports axi_clk] [get_bd_pins axi_dma/m_axi_s2mm_aclk] [get_bd_pins axi_dma/s_axi_lite_aclk] [get_bd_pins ps_reset/slowest_sync_clk] [get_bd_pins z7ps/S_AXI_HP0_ACLK] [get_bd_pins z7ps/M_AXI_GP0_ACLK] [get_bd_pins smartconnect32/aclk] [get_bd_pins smartconnect64/aclk]
+  connect_bd_net -net z7ps_FCLK_CLK0 [get_bd_pins z7ps/FCLK_CLK0] [get_bd_ports axi_clk] [get_bd_pins axi_dma/m_axi_s2mm_aclk] [get_bd_pins axi_dma/m_axi_sg_aclk] [get_bd_pins axi_dma/s_axi_lite_aclk] [get_bd_pins ps_reset/slowest_sync_clk] [get_bd_pins z7ps/${cap_port}_ACLK] [get_bd_pins z7ps/M_AXI_GP0_ACLK] [get_bd_pins smartconnect32/aclk] [get_bd_pins smartconnect64/aclk]
   connect_bd_net -net z7ps_FCLK_RESET0_N [get_bd_pins ps_reset/peripheral_aresetn] [get_bd_ports axi_rst_n] [get_bd_pins axi_dma/axi_resetn] [get_bd_pins smartconnect32/aresetn] [get_bd_pins smartconnect64/aresetn]
 
   # Create address segments
-  assign_bd_address -offset 0x00000000 -range 0x20000000 -target_address_space [get_bd_addr_spaces axi_dma/Data_S2MM] [get_bd_addr_segs z7ps/S_AXI_HP0/HP0_DDR_LOWOCM] -force
+  assign_bd_address -offset 0x00000000 -range 0x20000000 -target_address_space [get_bd_addr_spaces axi_dma/Data_S2MM] [get_bd_addr_segs z7ps/$cap_port/$cap_seg] -force
+  assign_bd_address -offset 0x00000000 -range 0x20000000 -target_address_space [get_bd_addr_spaces axi_dma/Data_SG] [get_bd_addr_segs z7ps/$cap_port/$cap_seg] -force
   assign_bd_address -offset 0x40010000 -range 0x00010000 -target_address_space [get_bd_addr_spaces z7ps/Data] [get_bd_addr_segs axi_dma/S_AXI_LITE/Reg] -force
   assign_bd_address -offset 0x40020000 -range 0x00010000 -target_address_space [get_bd_addr_spaces z7ps/Data] [get_bd_addr_segs maxi32/Reg] -force
 
@@ -761,6 +803,7 @@ proc create_root_design { parentCell } {
    "guistr":"# # String gsaved with Nlview 7.5.8 2022-09-21 7111 VDI=41 GEI=38 GUI=JA:10.0
 #  -string -flagsOSRD
 preplace port saxis64 -pg 1 -lvl 0 -x -90 -y 230 -defaultsOSRD
+preplace port port-id_cap_irq -pg 1 -lvl 0 -x -90 -y 430 -defaultsOSRD
 preplace port maxi32 -pg 1 -lvl 5 -x 1640 -y 300 -defaultsOSRD
 preplace port port-id_axi_clk -pg 1 -lvl 5 -x 1640 -y 210 -defaultsOSRD
 preplace portBus axi_rst_n -pg 1 -lvl 5 -x 1640 -y 490 -defaultsOSRD
@@ -769,11 +812,16 @@ preplace inst ps_reset -pg 1 -lvl 4 -x 1450 -y 450 -defaultsOSRD
 preplace inst z7ps -pg 1 -lvl 3 -x 1030 -y 260 -defaultsOSRD
 preplace inst smartconnect32 -pg 1 -lvl 4 -x 1450 -y 290 -defaultsOSRD
 preplace inst smartconnect64 -pg 1 -lvl 2 -x 640 -y 250 -defaultsOSRD
+preplace inst irq_concat -pg 1 -lvl 2 -x 640 -y 440 -defaultsOSRD
 preplace netloc processing_system7_0_FCLK_RESET0_N 1 3 1 1260 310n
 preplace netloc z7ps_FCLK_CLK0 1 0 5 140 150 500 150 800 150 1280 210 N
 preplace netloc z7ps_FCLK_RESET0_N 1 0 5 140 350 500 370 N 370 1270 550 1620
 preplace netloc S_AXIS_S2MM_0_1 1 0 1 N 230
 preplace netloc axi_dma_M_AXI_S2MM 1 1 1 N 230
+preplace netloc axi_dma_M_AXI_SG 1 1 1 N 250
+preplace netloc axi_dma_s2mm_introut 1 1 1 510 270n
+preplace netloc cap_irq_1 1 0 2 NJ 430 520J
+preplace netloc irq_concat_dout 1 2 1 810 330n
 preplace netloc processing_system7_0_M_AXI_GP0 1 3 1 N 270
 preplace netloc smartconnect64_M00_AXI 1 2 1 N 250
 preplace netloc smartconnect_M00_AXI 1 0 5 130 140 N 140 NJ 140 NJ 140 1620
@@ -21,12 +21,24 @@
 # output audio to WAV
 
 # standard modules
-import sys,os,argparse,struct,socket,array,time
+import sys,os,argparse,struct,socket,select,array,time
 from datetime import datetime
 
+# third party
+import numpy as np
+
 # local package
 import spec
 
+# local modules
+import tmds_dec
+import tmds_raw
+import tmds_decoded
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)),*[os.pardir]*4,'common','video'))
+import hdmi_bch # BCH ECC (shared with HDL table generator)
+from tmds_dec import PERIOD_UNKNOWN,PERIOD_CTRL,PERIOD_VIDEO_PRE,PERIOD_VIDEO_GB,PERIOD_VIDEO, \
+    PERIOD_DATA_PRE,PERIOD_DATA_GB_LEADING,PERIOD_DATA_GB_TRAILING,PERIOD_DATA
+
 start_time = datetime.now()
 
 print("-------------------------------------------------------------------------------")
@@ -42,45 +54,261 @@ parser = argparse.ArgumentParser(
     epilog='See https://github.com/amb5l/tyto2'
     )
 
+# hardware trigger modes (TRIGCTRL values)
+TRIG_MODES = {'none': 0, 'vsync': 1, 'vsync-': 1|(1<<4), 'island': 2, 'packet': 3}
+
 group = parser.add_mutually_exclusive_group(required=True)
 group.add_argument('-n',type=int,default=PIXELS,help='capture N pixels from hardware (default: %(default)s)')
 group.add_argument('-i',metavar='filename',default=None,help='read raw TMDS data from specified file (default: %(default)s)')
 group.add_argument('-r',metavar='filename',default=None,help='read decoded TMDS data from specified file (default: %(default)s)')
+group.add_argument('-l',action='store_true',help='list servers that answer a discovery query, then exit')
 parser.add_argument('-o',metavar='filename',default=None,required=False,help='write raw TMDS data to specified file (default: %(default)s)')
 parser.add_argument('-w',metavar='filename',default=None,help='write decoded TMDS data to specified file (default: %(default)s)')
+parser.add_argument('-d',action='store_true',help='dense (30 bit) packing of pixels for transfer from hardware')
+parser.add_argument('-c',action='store_true',help='compressed (run length encoded) transfer from hardware')
+parser.add_argument('-u',action='store_true',help='UDP (blast) transfer from hardware, with retransmission of lost datagrams')
+parser.add_argument('-t',choices=TRIG_MODES,default='none',help='hardware trigger: VSYNC rising/falling edge, data island preamble, or packet header (default: %(default)s)')
+parser.add_argument('-p',type=int,default=0,help='pre-trigger depth (pixels) (default: %(default)s)')
+parser.add_argument('-k',metavar='hdr[/mask]',default='0/0',help='packet header to trigger on (HB2:HB1:HB0 as 24 bit hex, optionally masked) (default: %(default)s)')
+parser.add_argument('-y',metavar='first[:count]',default=None,help='capture window: lines (from VSYNC) (default: all)')
+parser.add_argument('-x',metavar='first[:count]',default=None,help='capture window: pixels (from HSYNC) (default: all)')
+parser.add_argument('-f',type=int,default=0,help='capture window: frames to skip after each captured frame (default: %(default)s)')
+parser.add_argument('-a',choices=['++','+-','-+','--'],default='++',help='capture window: HSYNC and VSYNC polarity (default: %(default)s)')
+parser.add_argument('-e',action='store_true',help='capture N data island packets (extracted and ECC checked by hardware), list them, then exit')
+parser.add_argument('-m',action='store_true',help='read video timing measured by hardware, then exit (no capture)')
+parser.add_argument('-v',action='store_true',help='monitor video signatures (per field CRC) made by hardware until interrupted (no capture)')
+parser.add_argument('-g',type=int,metavar='MS',default=0,help='monitor alignment and capture counters, sampled every MS ms, until interrupted (no capture)')
+parser.add_argument('-s',action='store_true',help='shared: use the server\'s last capture if big enough (e.g. one taken for another client)')
+parser.add_argument('-b',choices=['auto','native','numpy'],default='auto',help='decoder: native library (see tmds_dec.py), NumPy, or native if available (default: %(default)s)')
+parser.add_argument('-j',type=int,metavar='THREADS',default=1,help='native decode on THREADS cores (0 = all), after the transfer rather than as data arrives (default: %(default)s)')
 
 args = parser.parse_args()
 if args.o and not args.n:
    parser.error("Writing raw TMDS data is only supported when capturing from hardware (-n)")
 if args.w and args.r:
    parser.error("Writing decoded TMDS data is not supported when reading decoded TMDS data")
+if args.c and args.d:
+   parser.error("Dense packing and compression are mutually exclusive")
+if args.c and args.u:
+   parser.error("Compression is not supported for UDP transfers")
+if args.m and (args.i or args.r):
+   parser.error("Timing measurement requires hardware")
+if args.v and (args.i or args.r):
+   parser.error("Video signature monitoring requires hardware")
+if args.g and (args.i or args.r):
+   parser.error("Telemetry requires hardware")
+if args.b == 'native' and not tmds_dec.lib:
+   parser.error("Native decoder library not found (build it with build/tmds_cap/tmds_dec/makefile, or set TMDS_DEC_LIB)")
+if args.e and (args.i or args.r or args.d or args.c):
+   parser.error("Packet capture requires hardware, and is neither dense nor compressed")
+if args.j < 0:
+   parser.error("Thread count must not be negative")
 n = args.n
 infile_raw = args.i
 outfile_raw = args.o
 infile_dec = args.r
 outfile_dec = args.w
+dense = args.d and not (infile_raw or infile_dec)
+rle = args.c and not (infile_raw or infile_dec)
+shared = args.s
+trig_hdr,_,trig_mask = args.k.partition('/')
+trig = [TRIG_MODES[args.t],args.p,int(trig_hdr,16),int(trig_mask,16) if trig_mask else 0xFFFFFF]
+udp = args.u and not (infile_raw or infile_dec)
+threads = args.j or os.cpu_count()
+stream = tmds_dec.lib is not None and args.b != 'numpy' and threads == 1 # decode TCP transfers as they arrive
+dec = None # tmds_dec.Stream, if decoding as data arrives
+def win_range(r):
+    first,_,count = r.partition(':') if r else ('0','','0')
+    return (int(count or 0)<<16)|int(first)
+win = [0,win_range(args.y),win_range(args.x),args.f]
+if args.y or args.x or args.f:
+    win[0] = 1|(0x10 if args.a[0] == '-' else 0)|(0x20 if args.a[1] == '-' else 0) # WINCTRL
 
 ################################################################################
 # get TMDS data from infile_raw or hardware
 
 BYTES_PER_PIXEL = 4
+DENSE_PIXELS = 16 # dense packing: 16 pixels...
+DENSE_BYTES  = 60 # ...in 60 bytes
+
+# unpack dense (30 bit) TMDS data to one pixel per 32 bit word
+# pixel k of each group starts at bit 30*k, so spans at most 5 bytes
+def unpack_dense(b,n):
+    g = (len(b)+DENSE_BYTES-1)//DENSE_BYTES
+    t = np.zeros(g*DENSE_BYTES,dtype=np.uint8)
+    t[:len(b)] = np.frombuffer(b,dtype=np.uint8)
+    a = np.zeros((g,DENSE_BYTES+4),dtype=np.uint64) # room to read past the last pixel
+    a[:,:DENSE_BYTES] = t.reshape(g,DENSE_BYTES)
+    r = np.empty((g,DENSE_PIXELS),dtype=np.uint32)
+    for k in range(DENSE_PIXELS):
+        i,sh = divmod(30*k,8)
+        v = a[:,i]|(a[:,i+1]<<8)|(a[:,i+2]<<16)|(a[:,i+3]<<24)|(a[:,i+4]<<32)
+        r[:,k] = (v >> sh) & 0x3FFFFFFF
+    return r.reshape(-1)[:n]
+
+# binary request/response protocol (see server/proto.h)
+PROTO_HDR         = struct.Struct('<BBBBL') # cmd, flags, status, tag, payload length
+PROTO_CMD_CAPTURE = 0x01
+PROTO_CMD_GET     = 0x02
+PROTO_CMD_STATUS  = 0x03
+PROTO_CMD_REGS    = 0x04
+PROTO_CMD_BLAST   = 0x05
+PROTO_CMD_RESEND  = 0x06
+PROTO_CMD_TIMING  = 0x07
+PROTO_CMD_CRC     = 0x08
+PROTO_CMD_TELEM   = 0x09
+CSR_FREQ          = 1 # FREQ, ASTAT: CSR word offsets (see tmds_cap_csr_ra.csv)
+PROTO_TIMING      = struct.Struct('<13L') # see proto_timing_t
+PROTO_CRC         = struct.Struct('<LL') # field, signature
+PROTO_TELEM       = struct.Struct('<16L') # see proto_telem_t
+TELEM_FIELDS      = ('seq','time','freq','astat','atap','abitslip',
+                     'again0','again1','again2','againp','aloss0','aloss1','aloss2','alossp','capstat','capcount')
+VTMSTAT_HVALID    = 1<<0
+VTMSTAT_VVALID    = 1<<1
+VTMSTAT_INTERLACE = 1<<2
+VTMSTAT_HPOL      = 1<<4
+VTMSTAT_VPOL      = 1<<5
+PROTO_CAP_DENSE   = 1<<0
+PROTO_CAP_REUSE   = 1<<1
+PROTO_CAP_PKT     = 1<<2
+PROTO_PKT         = struct.Struct('<Q3sB28s') # timestamp, header, status, subpacket bytes
+PROTO_PKT_E_HB    = 1<<0
+PROTO_GET_RLE     = 1<<0
+PROTO_FLAG_LAST   = 1<<0
+PROTO_OK          = 0x00
+PROTO_E_SIZE      = 0x03
+PROTO_E_BUSY      = 0x05
+PROTO_E_STALE     = 0x06
+PROTO_DISCO       = struct.Struct('<16s5LHH') # see proto_disco_t
+PROTO_DISCO_QUERY = b'tmds_cap query'
+PROTO_DISCO_MAGIC = b'tmds_cap disco'
+
+# telemetry datagram to list of records (dicts keyed by TELEM_FIELDS)
+def telem_decode(d):
+    return [dict(zip(TELEM_FIELDS,r)) for r in PROTO_TELEM.iter_unpack(d)]
+
+def proto_req(cmd,tag,payload=b''):
+    return PROTO_HDR.pack(cmd,0,0,tag,len(payload))+payload
+
+# receive into b until full or connection closed, return bytes received
+def recv_exact(s,b):
+    i = 0
+    while i < len(b):
+        nr = s.recv_into(b[i:])
+        if nr == 0:
+            break
+        i += nr
+    return i
+
+def proto_recv_hdr(s):
+    h = memoryview(bytearray(PROTO_HDR.size))
+    if recv_exact(s,h) != PROTO_HDR.size:
+        print("connection to server lost")
+        sys.exit(1)
+    return PROTO_HDR.unpack(h)
+
+# UDP blast: datagrams carry a sequence number, lost ones are requested again
+BLAST_HDR   = struct.Struct('<LL') # sequence number, capture generation
+BLAST_BYTES = 366*4 # data bytes per datagram
+BLAST_QUIET = 0.05 # seconds without datagrams after which the rest are presumed lost
+BLAST_NACKS = 8 # (first, count) pairs per resend request
+
+# receive nb bytes of blasted data on s_udp, return them and number of datagrams resent
+def blast_recv(s_tcp,s_udp,nb):
+    b = memoryview(bytearray(nb))
+    count = (nb+BLAST_BYTES-1)//BLAST_BYTES
+    got = bytearray(count)
+    missing = count
+    resent = 0
+    while True:
+        # receive datagrams until the server has sent them all, then until quiet
+        sent = False
+        while True:
+            r,_,_ = select.select([s_udp] if sent else [s_udp,s_tcp],[],[],BLAST_QUIET if sent else None)
+            if s_tcp in r:
+                _,_,status,_,l = proto_recv_hdr(s_tcp)
+                recv_exact(s_tcp,memoryview(bytearray(l)))
+                if status != PROTO_OK:
+                    print("blast request failed (status %d)" % status)
+                    sys.exit(1)
+                sent = True
+            elif s_udp in r:
+                d = s_udp.recv(BLAST_HDR.size+BLAST_BYTES)
+                seq,_ = BLAST_HDR.unpack_from(d)
+                if seq < count and not got[seq]:
+                    i = seq*BLAST_BYTES
+                    b[i:i+len(d)-BLAST_HDR.size] = d[BLAST_HDR.size:]
+                    got[seq] = 1
+                    missing -= 1
+            elif sent:
+                break
+        if not missing:
+            return b,resent
+        # request the first few missing ranges
+        nacks = []
+        seq = got.find(0)
+        while seq >= 0 and len(nacks) < 2*BLAST_NACKS:
+            end = got.find(1,seq)
+            if end < 0:
+                end = count
+            nacks += [seq,end-seq]
+            resent += end-seq
+            seq = got.find(0,end)
+        s_tcp.sendall(proto_req(PROTO_CMD_RESEND,4,struct.pack('<%dL' % len(nacks),*nacks)))
+
+RLE_REPEAT = 0x80000000 # RLE word is a repeat count, else a literal pixel
+
+# unpack run length encoded TMDS data into r (uint32 array) from pixel j, return new j and last literal
+def unpack_rle(b,r,j,last):
+    w = np.frombuffer(b,dtype='<u4')
+    if not len(w):
+        return j,last
+    rep = (w & RLE_REPEAT) != 0
+    # repeat words stand for the literal before them (which may be in an earlier call)
+    i = np.where(rep,-1,np.arange(len(w)))
+    np.maximum.accumulate(i,out=i)
+    v = np.where(i < 0,np.uint32(last),w[np.maximum(i,0)])
+    v = np.repeat(v,np.where(rep,w & ~np.uint32(RLE_REPEAT),1))
+    r[j:j+len(v)] = v
+    return j+len(v),int(v[-1]) if len(v) else last
+
+STREAM_BYTES = 1 << 18 # dense data is unpacked for decode this much at a time
+
+# receive nb bytes of (sparse or dense) TMDS data from s, return buffer and
+# bytes received; with dec, pixels are decoded as they arrive
+def recv_tmds(s,nb,dec):
+    b = memoryview(dec.packed).cast('B')[:nb] if dec and not dense else memoryview(bytearray(nb))
+    i,j,u = 0,0,0 # bytes received, pixels present, bytes unpacked
+    while i < nb:
+        nr = s.recv_into(b[i:])
+        if not nr:
+            break
+        i += nr
+        if dec:
+            if not dense:
+                j = i//BYTES_PER_PIXEL
+            elif i == nb or i-u >= STREAM_BYTES:
+                k = min(DENSE_PIXELS*(i//DENSE_BYTES),n)
+                dec.packed[j:k] = unpack_dense(b[u:DENSE_BYTES*(i//DENSE_BYTES)],k-j)
+                j,u = k,DENSE_BYTES*(i//DENSE_BYTES)
+            dec.run(j)
+    return b,i
 
 if infile_raw:
     # read raw TMDS data from file
     print("reading raw TMDS data from %s..." % infile_raw,end=" ")
-    f = open(infile_raw, 'rb')
-    nb = os.path.getsize(infile_raw)
-    if nb % 4 != 0:
-        print("size of %s is not a multiple of %d" % (infile_raw,BYTES_PER_PIXEL))
-        sys.exit(1)
-    tmds_bytes = memoryview(bytearray(nb))
-    nr = f.readinto(tmds_bytes)
-    f.close()
-    if nb != nr:
-        print("failed to read %s correctly (expected %d, read %d)" % (infile_raw,nb,nr))
+    try:
+        raw,tmds_bytes = tmds_raw.read(infile_raw) # mapped, not copied
+    except ValueError as e:
+        print(e)
         sys.exit(1)
-    n = nb//BYTES_PER_PIXEL
-    print("%d pixels read" % n)
+    n = raw.pixels
+    dense = raw.packing == tmds_raw.DENSE
+    cap_freq,cap_astat,cap_time_us = raw.freq,raw.astat,raw.time_us # kept if written out again (-o)
+    print("%d pixels read%s" % (n," (dense)" if dense else ""))
+    if raw.version:
+        print("captured %s, pixel clock %.2f MHz (%s)" % (datetime.fromtimestamp(raw.time_us/1e6).strftime('%Y-%m-%d %H:%M:%S'),
+            raw.freq/100.0,"locked" if raw.astat & 1 else "unlocked"))
 elif not infile_dec:
     # read raw TMDS data from hardware
     s_myip = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
@@ -92,83 +320,293 @@ elif not infile_dec:
     UDP_MAX_PAYLOAD = 1472
     TCP_PORT = 65401
     TCP_MAX_PAYLOAD = 1460
-    print("listening for server advertisements (UDP broadcasts) on port %d..." % UDP_PORT)
-    s_bcast = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-    s_bcast.bind(('', UDP_PORT))
-    while True:
-        data, addr = s_bcast.recvfrom(UDP_MAX_PAYLOAD) # buffer size is 1024 bytes
-        if addr[1] != UDP_PORT:
-            print("unexpected source port (%s)" % addr[1])
-        if data == b'tmds_cap disco':
-            server_ip = addr[0]
-            break
-        else:
-            print("unexpected data (%s)" % data)
-    s_bcast.close()
+    # broadcast a discovery query; servers reply at once
+    def disco_query(tries,wait,first):
+        s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        s.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+        found = {}
+        for _ in range(tries):
+            s.sendto(PROTO_DISCO_QUERY,('<broadcast>',UDP_PORT))
+            t = time.time()+wait
+            while time.time() < t:
+                if not select.select([s],[],[],max(0,t-time.time()))[0]:
+                    break
+                data, addr = s.recvfrom(UDP_MAX_PAYLOAD)
+                if len(data) == PROTO_DISCO.size and data.startswith(PROTO_DISCO_MAGIC):
+                    found[addr[0]] = PROTO_DISCO.unpack(data)[1:]
+                    if first:
+                        break
+            if found:
+                break
+        s.close()
+        return found
+    def disco_print(ip,d):
+        version,signature,buf_bytes,freq,astat,port,clients = d
+        print("server at %s (port %d): version %d.%d, buffer %d MiB, pixel clock %.2f MHz (%s), %d client(s) connected" %
+            (ip,port,version>>8,version&0xFF,buf_bytes>>20,freq/100.0,"locked" if astat & 1 else "unlocked",clients))
+    if args.l:
+        found = disco_query(2,0.5,False)
+        for ip,d in found.items():
+            disco_print(ip,d)
+        if not found:
+            print("no servers found")
+        sys.exit(0)
+    print("querying for servers (UDP broadcast) on port %d..." % UDP_PORT)
+    found = disco_query(5,0.2,True)
+    if found:
+        server_ip,d = next(iter(found.items()))
+        disco_print(server_ip,d)
+        TCP_PORT = d[5]
+    else:
+        # server does not answer queries: wait for its advertisement
+        print("listening for server advertisements (UDP broadcasts) on port %d..." % UDP_PORT)
+        s_bcast = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        s_bcast.bind(('', UDP_PORT))
+        while True:
+            data, addr = s_bcast.recvfrom(UDP_MAX_PAYLOAD) # buffer size is 1024 bytes
+            if addr[1] != UDP_PORT:
+                print("unexpected source port (%s)" % addr[1])
+            if data == PROTO_DISCO_MAGIC:
+                server_ip = addr[0]
+                break
+            else:
+                print("unexpected data (%s)" % data)
+        s_bcast.close()
     s_tcp = socket.socket(socket.AF_INET, socket.SOCK_STREAM) # TCP socket
     print("connecting to server at", server_ip)
     s_tcp.connect((server_ip,TCP_PORT))
     print("CONNECTION ESTABLISHED")
-    print("requesting %d pixels..." % n)
+    if args.m:
+        s_tcp.sendall(proto_req(PROTO_CMD_TIMING,1))
+        _,_,status,_,l = proto_recv_hdr(s_tcp)
+        d = memoryview(bytearray(l))
+        recv_exact(s_tcp,d)
+        s_tcp.close()
+        if status != PROTO_OK or l != PROTO_TIMING.size:
+            print("timing request failed (status %d)" % status)
+            sys.exit(1)
+        stat,h_total,h_active,h_fp,h_sync,h_bp,v_total,v_active,v_fp,v_sync,v_bp,f_total,freq = PROTO_TIMING.unpack(d)
+        if not stat & VTMSTAT_HVALID:
+            print("horizontal timing not stable")
+        else:
+            print("h: active %d, front porch %d, sync %d (%s), back porch %d, total %d" %
+                (h_active,h_fp,h_sync,"+" if stat & VTMSTAT_HPOL else "-",h_bp,h_total))
+        if not stat & VTMSTAT_VVALID:
+            print("vertical timing not stable")
+        else:
+            print("v: active %d, front porch %d, sync %d (%s), back porch %d, total %d%s" %
+                (v_active,v_fp,v_sync,"+" if stat & VTMSTAT_VPOL else "-",v_bp,v_total," (interlaced)" if stat & VTMSTAT_INTERLACE else ""))
+            print("%d pixels per frame" % f_total)
+        sys.exit(0)
+    if args.v:
+        # print the first signature, then only changes and lost signatures
+        s_udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        s_udp.bind(('',0))
+        s_tcp.sendall(proto_req(PROTO_CMD_CRC,1,struct.pack('<L',s_udp.getsockname()[1])))
+        _,_,status,_,l = proto_recv_hdr(s_tcp)
+        recv_exact(s_tcp,memoryview(bytearray(l)))
+        if status != PROTO_OK:
+            print("signature request failed (status %d)" % status)
+            sys.exit(1)
+        print("monitoring video signatures (press Ctrl-C to stop)...")
+        last_field,last_crc,fields,changes,lost = None,None,0,0,0
+        try:
+            while True:
+                d = s_udp.recv(UDP_MAX_PAYLOAD)
+                for field,crc in PROTO_CRC.iter_unpack(d):
+                    if last_field is not None and field != last_field+1:
+                        print("field %d: %d signatures lost" % (field,field-last_field-1))
+                        lost += field-last_field-1
+                    if crc != last_crc:
+                        print("field %d: signature %08X%s" % (field,crc,"" if last_crc is None else " (changed)"))
+                        changes += 0 if last_crc is None else 1
+                    last_field,last_crc = field,crc
+                    fields += 1
+        except KeyboardInterrupt:
+            pass
+        s_udp.close()
+        s_tcp.close()
+        print("%d fields: %d changes, %d signatures lost" % (fields,changes,lost))
+        sys.exit(0)
+    if args.g:
+        # print the first record, then only records in which something other than the capture count changed
+        s_udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        s_udp.bind(('',0))
+        s_tcp.sendall(proto_req(PROTO_CMD_TELEM,1,struct.pack('<LL',s_udp.getsockname()[1],args.g)))
+        _,_,status,_,l = proto_recv_hdr(s_tcp)
+        d = memoryview(bytearray(l))
+        recv_exact(s_tcp,d)
+        if status != PROTO_OK:
+            print("telemetry request failed (status %d)" % status)
+            sys.exit(1)
+        interval,_ = struct.unpack('<LL',d)
+        print("monitoring telemetry every %d ms (press Ctrl-C to stop)..." % interval)
+        last,records,lost = None,0,0
+        try:
+            while True:
+                for r in telem_decode(s_udp.recv(UDP_MAX_PAYLOAD)):
+                    if last and r['seq'] != last['seq']+1:
+                        print("record %d: %d records lost" % (r['seq'],r['seq']-last['seq']-1))
+                        lost += r['seq']-last['seq']-1
+                    if not last or any(r[k] != last[k] for k in TELEM_FIELDS[2:-1]):
+                        print(("%10d ms: FREQ %.2f MHz, ASTAT %03X, ATAP %06X, ABITSLIP %03X, "
+                            "AGAIN %d/%d/%d/%d, ALOSS %d/%d/%d/%d, CAPSTAT %02X, CAPCOUNT %d") %
+                            (r['time'],r['freq']/100.0,r['astat'],r['atap'],r['abitslip'],
+                            r['again0'],r['again1'],r['again2'],r['againp'],
+                            r['aloss0'],r['aloss1'],r['aloss2'],r['alossp'],r['capstat'],r['capcount']))
+                    last = r
+                    records += 1
+        except KeyboardInterrupt:
+            pass
+        s_udp.close()
+        s_tcp.close()
+        print("%d records, %d lost" % (records,lost))
+        sys.exit(0)
+    print("requesting %d %s%s%s..." % (n,"packets" if args.e else "pixels"," (dense)" if dense else " (compressed)" if rle else ""," (UDP)" if udp else ""))
     t0 = time.perf_counter()
-    s_tcp.sendall(b'tmds_cap get '+bytes(str(n),'utf-8'))
-    tmds_bytes = memoryview(bytearray(n*BYTES_PER_PIXEL))
+    cap_time_us = int(time.time()*1e6)
+    # read registers (for raw file header), capture to server buffer, then get all of it (pipelined requests)
+    req = proto_req(PROTO_CMD_REGS,0)+proto_req(PROTO_CMD_CAPTURE,1,struct.pack('<LL',n,(PROTO_CAP_DENSE if dense else 0)|(PROTO_CAP_REUSE if shared else 0)|(PROTO_CAP_PKT if args.e else 0))+
+        (struct.pack('<8L',*trig,*win) if win[0] else struct.pack('<4L',*trig) if trig[0] else b''))
+    if udp:
+        s_udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        s_udp.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1<<26) # ride out bursts
+        s_udp.bind(('',0))
+        req += proto_req(PROTO_CMD_BLAST,3,struct.pack('<LLLL',0,n,0,s_udp.getsockname()[1]))
+    else:
+        req += proto_req(PROTO_CMD_GET,2,struct.pack('<LLL',0,n,PROTO_GET_RLE if rle else 0))
+    s_tcp.sendall(req)
+    _,_,status,_,l = proto_recv_hdr(s_tcp)
+    d = memoryview(bytearray(l))
+    recv_exact(s_tcp,d) # CSRs
+    cap_freq,cap_astat = struct.unpack_from('<LL',d,4*CSR_FREQ) if status == PROTO_OK else (0,0)
+    _,_,status,_,l = proto_recv_hdr(s_tcp)
+    d = memoryview(bytearray(l))
+    recv_exact(s_tcp,d) # buffer words, capture generation
+    if status == PROTO_OK:
+        print("capture generation %d" % struct.unpack('<LL',d)[1])
     i = 0
-    while i < n*BYTES_PER_PIXEL:
-        nr = s_tcp.recv_into(tmds_bytes[i:])
-        if nr == 0:
+    if status == PROTO_OK:
+        if udp:
+            nb = PROTO_PKT.size*n if args.e else DENSE_BYTES*((n+DENSE_PIXELS-1)//DENSE_PIXELS) if dense else n*BYTES_PER_PIXEL
+            tmds_bytes,i = blast_recv(s_tcp,s_udp,nb)
+            s_udp.close()
+            print("%d datagrams resent" % i)
+        elif rle:
+            # unpack (and decode) frames as they arrive
+            dec = tmds_dec.Stream(n) if stream else None
+            tmds_packed = dec.packed if dec else np.zeros(n,dtype=np.uint32)
+            j,last,flags = 0,0,0
+            while not flags & PROTO_FLAG_LAST:
+                _,flags,status,_,l = proto_recv_hdr(s_tcp)
+                if status != PROTO_OK:
+                    print("get request failed (status %d)" % status)
+                    sys.exit(1)
+                d = memoryview(bytearray(l))
+                i += recv_exact(s_tcp,d)
+                j,last = unpack_rle(d,tmds_packed,j,last)
+                if dec:
+                    dec.run(j)
+            print("%d bytes received for %d pixels (%.1f%%)" % (i,n,(100.0*i)/(n*BYTES_PER_PIXEL)))
+        else:
+            _,_,status,_,nb = proto_recv_hdr(s_tcp)
+            if status != PROTO_OK:
+                print("get request failed (status %d)" % status)
+                sys.exit(1)
+            dec = tmds_dec.Stream(n) if stream else None
+            tmds_bytes,i = recv_tmds(s_tcp,nb,dec)
+            if i != nb:
+                print("failed to read from hardware after %d bytes" % i)
+                sys.exit(1)
+    elif status == PROTO_E_SIZE and args.e:
+        print("packet capture exceeds server buffer")
+        sys.exit(1)
+    elif status == PROTO_E_SIZE:
+        # too big for server buffer: capture and stream (legacy text command)
+        proto_recv_hdr(s_tcp) # get fails
+        print("capture exceeds server buffer - streaming")
+        if trig[0] or win[0]:
+            print("warning: trigger and window are not supported when streaming")
+        if rle:
+            s_tcp.sendall(b'tmds_cap get '+bytes(str(n),'utf-8')+b' rle')
+            nb = 0
+        elif dense:
+            s_tcp.sendall(b'tmds_cap get '+bytes(str(n),'utf-8')+b' dense')
+            nb = DENSE_BYTES*((n+DENSE_PIXELS-1)//DENSE_PIXELS)
+        else:
+            s_tcp.sendall(b'tmds_cap get '+bytes(str(n),'utf-8'))
+            nb = n*BYTES_PER_PIXEL
+        dec = tmds_dec.Stream(n) if stream else None
+        tmds_bytes,i = recv_tmds(s_tcp,nb,None if rle else dec)
+        if i != nb:
             print("failed to read from hardware after %d bytes" % i)
             sys.exit(1)
+        if rle:
+            # unpack (and decode) as data arrives, until all pixels are present
+            tmds_packed = dec.packed if dec else np.zeros(n,dtype=np.uint32)
+            j,last,b = 0,0,b''
+            while j < n:
+                d = s_tcp.recv(65536)
+                if not d:
+                    print("failed to read from hardware after %d bytes" % i)
+                    sys.exit(1)
+                i += len(d)
+                b += d
+                m = len(b) & ~3
+                j,last = unpack_rle(b[:m],tmds_packed,j,last)
+                b = b[m:]
+                if dec:
+                    dec.run(j)
+            print("%d bytes received for %d pixels (%.1f%%)" % (i,n,(100.0*i)/(n*BYTES_PER_PIXEL)))
+    elif status == PROTO_E_BUSY:
+        print("capture buffer in use by other clients (try -s to share their capture)")
+        sys.exit(1)
+    else:
+        print("capture request failed (status %d)" % status)
+        sys.exit(1)
     print("done (total time = %.2f seconds)" % (time.perf_counter()-t0))
     s_tcp.close()
+    if args.e:
+        # list packets, write them to file if required
+        for ts,hb,st,pb in PROTO_PKT.iter_unpack(tmds_bytes):
+            print("%12d: %-48s HB = %s PB = %s%s" % (ts,spec.hdmi.PACKET_TYPES.get(hb[0],"unknown (0x%02X)" % hb[0]),
+                hb.hex(' '),pb.hex(' '),"" if not st else " bad ECC (%s)" % ("header" if st & PROTO_PKT_E_HB else "subpacket")))
+        if outfile_raw:
+            print("writing packets to %s..." % outfile_raw)
+            with open(outfile_raw, 'wb') as f:
+                f.write(tmds_bytes)
+        sys.exit(0)
 
 if not infile_dec:
 
     # convert raw bytes to 32 bit TMDS triplets (3 x 10 bits)
-    tmds_packed = tmds_bytes.cast('L')
-
-    # write TMDS data to file if required
+    if dec:
+        tmds_packed = dec.packed
+    elif dense:
+        tmds_packed = unpack_dense(tmds_bytes,n)
+    elif not rle:
+        tmds_packed = tmds_bytes.cast('I') # 32 bits ('L' is 64 bits on some platforms)
+
+    # write TMDS data to file if required (as received)
     if outfile_raw:
         print("writing raw TMDS data to %s..." % outfile_raw)
-        with open(outfile_raw, 'wb') as f:
-            for d in tmds_packed:
-                f.write(struct.pack('<L',d))
-        f.close()
-
-    # separate channels from packed TMDS data
-    print("separating TMDS channels")
-    tmds = []
-    for ch in range(3):
-        tmds.append(array.array('h',n*[-1]))
-    for i in range(n):
-        l = tmds_packed[i]
-        tmds[0][i] = l & 0x3FF
-        l >>= 10
-        tmds[1][i] = l & 0x3FF
-        l >>= 10
-        tmds[2][i] = l & 0x3FF
+        tmds_raw.write(outfile_raw,tmds_bytes if dense else tmds_packed,n,tmds_raw.DENSE if dense else tmds_raw.SPARSE,
+            cap_freq,cap_astat,cap_time_us)
 
 ################################################################################
 # analysis: constants and variables
 
-# flag values for period type
-PERIOD_UNKNOWN          = 0
-PERIOD_CTRL             = 1
-PERIOD_VIDEO_PRE        = 2
-PERIOD_VIDEO_GB         = 4
-PERIOD_VIDEO            = 8
-PERIOD_DATA_PRE         = 16
-PERIOD_DATA_GB_LEADING  = 32 # used during prelim decode for *any* data guardband
-PERIOD_DATA_GB_TRAILING = 64
-PERIOD_DATA             = 128
-
-tmds_ch_p = [] # period flags per channel
-tmds_c = []*3 # 2 bit C value per channel, -1 = invalid
-for ch in range(3):
-    tmds_ch_p.append(array.array('B', n*[PERIOD_UNKNOWN]))
-    tmds_c.append(array.array('b', n*[-1]))
-tmds_p = array.array('B', n*[PERIOD_UNKNOWN]) # overall period flags
-tmds_sync = array.array('b', n*[-1]) # bit 0 = h sync, bit 1 = v sync
+# flag values for period type: see tmds_dec.py
+
+# tmds: TMDS characters per channel
+# tmds_ch_p: period flags per channel
+# tmds_c: 2 bit C value per channel, -1 = invalid
+# tmds_p: overall period flags
+# tmds_sync: bit 0 = h sync, bit 1 = v sync
+if dec: # already decoding
+    tmds,tmds_ch_p,tmds_c,tmds_p,tmds_sync = dec.tmds,dec.tmds_ch_p,dec.tmds_c,dec.tmds_p,dec.tmds_sync
+else:
+    tmds,tmds_ch_p,tmds_c,tmds_p,tmds_sync = tmds_dec.alloc(n)
 
 ################################################################################
 # measurements to be made
@@ -214,12 +652,6 @@ def vec2int(v):
         r |= v[i] << i
     return r
 
-def xor_vec(v):
-    r = 0
-    for bit in v:
-        r ^= bit
-    return r
-
 def xor_byte(b):
     r = 0
     for i in range(8):
@@ -232,23 +664,6 @@ def or_list(l):
         r |= e
     return r
 
-def bch_ecc(bytes):
-    q = int2vec(0,8);
-    n = q[:]
-    for byte in bytes:
-        d = int2vec(byte,8)
-        # see hdmi_bch_ecc.py
-        n[0] = xor_vec([d[0],d[1],d[2],d[4],d[5],d[7],q[0],q[1],q[2],q[4],q[5],q[7]])
-        n[1] = xor_vec([d[3],d[4],d[6],d[7],q[3],q[4],q[6],q[7]])
-        n[2] = xor_vec([d[1],d[2],q[1],q[2]])
-        n[3] = xor_vec([d[0],d[2],d[3],q[0],q[2],q[3]])
-        n[4] = xor_vec([d[0],d[1],d[3],d[4],q[0],q[1],q[3],q[4]])
-        n[5] = xor_vec([d[1],d[2],d[4],d[5],q[1],q[2],q[4],q[5]])
-        n[6] = xor_vec([d[0],d[2],d[3],d[5],d[6],q[0],q[2],q[3],q[5],q[6]])
-        n[7] = xor_vec([d[0],d[1],d[3],d[4],d[6],d[7],q[0],q[1],q[3],q[4],q[6],q[7]])
-        q = n[:]
-    return vec2int(q)
-
 def print_hex_list(bytes,end="\r\n"):
     for byte in bytes[:-1]:
         print("%02X" % byte,end=" ")
@@ -416,198 +831,31 @@ stop = False
 
 if not infile_dec:
 
-    print("preliminary period detection per channel")
-    for ch in range(3):
-        for i in range(n):
-            p = PERIOD_UNKNOWN
-            if tmds[ch][i] in spec.tmds.ctrl:
-                p |= PERIOD_CTRL
-                tmds_c[ch][i] = spec.tmds.ctrl.index(tmds[ch][i])
-                if ch > 0:
-                    if tmds_c[ch][i] > 0:
-                        m_protocol = 'HDMI'
-            if tmds[ch][i] == spec.tmds.video_gb[ch]:
-                p |= PERIOD_VIDEO_GB
-            if spec.tmds.video[tmds[ch][i]] != -1:
-                p |= PERIOD_VIDEO
-            if ch == 0:
-                if tmds[ch][i] in spec.tmds.terc4:
-                    p |= PERIOD_DATA
-            else:
-                if tmds[ch][i] == spec.tmds.data_gb:
-                    p |= PERIOD_DATA_GB_LEADING | PERIOD_DATA_GB_TRAILING
-                if tmds[ch][i] in spec.tmds.terc4:
-                    p |= PERIOD_DATA
-            if p == 0:
-                print("error: illegal TMDS character (offset %d, channel %d)" % (i,ch)); stop = True; break
-            tmds_ch_p[ch][i] = p
-
-    if not stop:
-        print("resolve control periods")
-        p_count = 0
-        for i in range(n):
-            cp = [tmds_ch_p[0][i],tmds_ch_p[1][i],tmds_ch_p[2][i]] # channel periods
-            # control periods should begin and end together across all channels
-            if (cp[0] | cp[1] | cp[2]) & PERIOD_CTRL: # control period for at least one channel
-                if cp[0] & cp[1] & cp[2] & PERIOD_CTRL: # control period across all
-                    tmds_p[i] = PERIOD_CTRL
-                    if m_start == -1 and tmds_c[1][i] == 0 and tmds_c[2][i] == 0:
-                        m_start = i
-                else:
-                    print("error: control period channel misalignment (offset %d)" % i); stop = True; break
-            else:
-                if p_count > 0 and p_count < spec.hdmi.CTRL_PERIOD_LEN_MIN:
-                    print("error: control period too short (offset %d)" % i); stop = True; break
-                p_count = 0
-
-    if not stop:
-        print("detect preambles")
-        for i in range(m_start,n):
-            cc = [tmds_c[0][i],tmds_c[1][i],tmds_c[2][i]] # channel C values
-            p = tmds_p[i]
-            if p & PERIOD_CTRL:
-                if cc[1] == 0 and cc[2] == 0: # normal control period
-                    pass
-                elif cc[1] == 1 and cc[2] == 0: # video preamble
-                    p |= PERIOD_VIDEO_PRE
-                elif cc[1] == 1 and cc[2] == 1: # data preamble
-                    p |= PERIOD_DATA_PRE
-                else:
-                    print("error: illegal control period CTL value (offset %d, CTL[3:0] = %s)", \
-                        i,format(cc[2],'#04b')[2:],format(cc[1],'#04b')[2:]); stop = True; break
-                tmds_p[i] = p
-
-    if not stop:
-        print("check preambles and detect data islands")
-        p_count = 0
-        p_type = ''
-        for i in range(n):
-            cp = [tmds_ch_p[0][i],tmds_ch_p[1][i],tmds_ch_p[2][i]] # channel periods
-            p = tmds_p[i]
-            if p_type == 'video_pre':
-                if p & PERIOD_VIDEO_PRE:
-                    p_count += 1
-                else:
-                    if p_count != spec.hdmi.PRE_LEN:
-                        print("error: bad video preamble length (offset %d, length %d)" % (i,p_count)); stop = True; break
-                    elif cp[0] & cp[1] & cp[2] & PERIOD_VIDEO_GB:
-                        p |= PERIOD_VIDEO_GB
-                        p_type = 'video_gb'
-                        p_count = 1
-                    else:
-                        print("error: expected video guardband after preamble (offset %d)" % i); stop = True; break
-            elif p_type == 'video_gb':
-                if cp[0] & cp[1] & cp[2] & PERIOD_VIDEO_GB:
-                    p |= PERIOD_VIDEO_GB
-                    p_count += 1
-                else:
-                    if p_count != spec.hdmi.GB_LEN:
-                        print("error: bad video guardband length (offset %d, length %d)" % (i,p_count)); stop = True; break
-                    p_type = ''
-                    p_count = 0
-            elif p_type == 'data_pre':
-                if p & PERIOD_DATA_PRE:
-                    p_count += 1
-                else:
-                    if p_count != spec.hdmi.PRE_LEN:
-                        print("error: bad data preamble length (offset %d, length %d)" % (i,p_count)); stop = True; break
-                    elif (cp[0] & PERIOD_DATA) and (cp[1] & cp[2] & PERIOD_DATA_GB_LEADING):
-                        p |= PERIOD_DATA_GB_LEADING
-                        p_type = 'data_gb_leading'
-                        p_count = 1
-                    else:
-                        print("error: expected data guardband after preamble (offset %d)" % i); stop = True; break
-            elif p_type == 'data_gb_leading':
-                if (cp[0] & PERIOD_DATA) and (cp[1] & cp[2] & PERIOD_DATA_GB_LEADING):
-                    p |= PERIOD_DATA_GB_LEADING
-                    p_count += 1
-                else:
-                    if p_count != spec.hdmi.GB_LEN:
-                        print("error: bad leading data guardband length (offset %d, length %d)" % (i,p_count)); stop = True; break
-                    elif cp[0] & cp[1] & cp[2] & PERIOD_DATA:
-                        p |= PERIOD_DATA
-                        p_type = 'data'
-                        p_count = 1
-                    else:
-                        printf("error: expected TERC4 after leading data guardband (offset %d)" % i); stop = True; break
-            elif p_type == 'data':
-                if cp[0] & cp[1] & cp[2] & PERIOD_DATA:
-                    p |= PERIOD_DATA
-                    p_count += 1
-                else:
-                    if p_count % spec.hdmi.PACKET_LEN != 0:
-                        print("error: non-integer multiple of data packets (offset %d, data length %d)" % (i,p_count)); stop = True; break
-                    elif (p_count // spec.hdmi.PACKET_LEN) > spec.hdmi.PACKET_MAX:
-                        print("error: too many consecutive data packets (offset %d)" % i); stop = True; break
-                    elif (cp[0] & PERIOD_DATA) and (cp[1] & cp[2] & PERIOD_DATA_GB_TRAILING):
-                        p |= PERIOD_DATA_GB_TRAILING
-                        p_type = 'data_gb_trailing'
-                        p_count = 1
-                    else:
-                        print("error: expected trailing data guardband after data (offset %d)" % i); stop = True; break
-            elif p_type == 'data_gb_trailing':
-                if (cp[0] & PERIOD_DATA) and (cp[1] & cp[2] & PERIOD_DATA_GB_LEADING):
-                    p |= PERIOD_DATA_GB_TRAILING
-                    p_count += 1
-                else:
-                    if p_count != spec.hdmi.GB_LEN:
-                        print("error: bad trailing data guardband length (offset %d, length %d)" % (i,p_count)); stop = True; break
-                    elif not p & PERIOD_CTRL:
-                        print("error: expected control period after data island (offset %d" % i); stop = True; break
-                    else:
-                        p_type = ''
-                        p_count = 0
-            else: # not currently processing a preamble or guardband
-                if p & PERIOD_VIDEO_PRE:
-                    p_type = 'video_pre'
-                    p_count = 1
-                elif p & PERIOD_DATA_PRE:
-                    p_type = 'data_pre'
-                    p_count = 1
-            tmds_p[i] = p
-
-    if not stop:
-        print("detect video periods")
-        p_count = 0
-        for i in range(n):
-            cp = [tmds_ch_p[0][i],tmds_ch_p[1][i],tmds_ch_p[2][i]] # channel periods
-            p = tmds_p[i]
-            if not p:
-                if cp[0] & cp[1] & cp[2] & PERIOD_VIDEO:
-                    p |= PERIOD_VIDEO
-                else:
-                    # this should be impossible
-                    print("error: non-video characters found in video period (offset %d, length %d)" % (i,p_count)); stop = True; break
-            tmds_p[i] = p
+    t0 = time.perf_counter()
+    if dec:
+        m_start,hdmi,stop = dec.finish()
+    else:
+        m_start,hdmi,stop = tmds_dec.decode(tmds_packed,tmds,tmds_ch_p,tmds_c,tmds_p,tmds_sync,args.b,threads)
+    if hdmi:
+        m_protocol = 'HDMI'
+    print("decode time = %.2f seconds" % (time.perf_counter()-t0))
 
-    # assumption - sync states persist after control and data periods
-    if not stop:
-        print("resolve syncs")
-        sync = -1
-        for i in range(n):
-            p = tmds_p[i]
-            if p & PERIOD_CTRL:
-                sync = tmds_c[0][i]
-            elif p & (PERIOD_DATA | PERIOD_DATA_GB_LEADING | PERIOD_DATA_GB_TRAILING):
-                sync = spec.tmds.terc4.index(tmds[0][i]) & 3
-            tmds_sync[i] = sync
-
-    # write decoded data to file
+    # write decoded data (and index) to file
     if outfile_dec:
         print("writing decoded TMDS data to %s..." % outfile_dec,end=" ")
-        f = open(outfile_dec, 'wb')
-        f.write(struct.pack('I', n))
-        f.write(struct.pack('I', m_start))
-        f.write(struct.pack('I', 1 if m_protocol == 'HDMI' else 0))
-        for i in range(3):
-            tmds[i].tofile(f)
-            tmds_ch_p[i].tofile(f)
-            tmds_c[i].tofile(f)
-        tmds_p.tofile(f)
-        tmds_sync.tofile(f)
+        tmds_decoded.write(outfile_dec,n,m_start,m_protocol == 'HDMI',tmds,tmds_ch_p,tmds_c,tmds_p,tmds_sync)
         print("%d pixels written" % n)
 
-else: # read decoded data from file
+elif open(infile_dec,'rb').read(len(tmds_decoded.MAGIC)) == tmds_decoded.MAGIC:
+    # map decoded data from file (pages are read as the analysis uses them)
+    print("reading decoded TMDS data from %s..." % infile_dec,end=" ")
+    d = tmds_decoded.Decoded(infile_dec)
+    n,m_start = d.n,d.m_start
+    m_protocol = 'HDMI' if d.hdmi else 'DVI'
+    tmds,tmds_ch_p,tmds_c,tmds_p,tmds_sync = d.tmds,d.tmds_ch_p,d.tmds_c,d.tmds_p,d.tmds_sync
+    print("%d pixels, %d frames, %d data islands" % (n,len(d.vsync),len(d.island)))
+
+else: # read decoded data from file (earlier format: no header or index)
     print("reading decoded TMDS data from %s..." % infile_dec,end=" ")
     f = open(infile_dec, 'rb')
     n = struct.unpack('I', f.read(4))[0]
@@ -982,22 +1230,25 @@ if not stop and m_protocol == "HDMI":
 
 if not stop and m_protocol == "HDMI":
     print("check data island packet ECC")
+    bch = hdmi_bch.Checker() # corrects single bit errors in place
     for _,packet_list in packet_dict.items():
         for d in packet_list:
-            if bch_ecc(d.get_hb_body()) != d.get_hb_ecc() \
-            or bch_ecc(d.get_sb_body()[0]) != d.get_sb_ecc()[0] \
-            or bch_ecc(d.get_sb_body()[1]) != d.get_sb_ecc()[1] \
-            or bch_ecc(d.get_sb_body()[2]) != d.get_sb_ecc()[2] \
-            or bch_ecc(d.get_sb_body()[3]) != d.get_sb_ecc()[3]:
-                print("packet %d: bad ECC" % i)
+            bad = False
+            for k,block in enumerate(d.bch_blocks):
+                r,bit = bch.check(block)
+                if r == hdmi_bch.CORRECTED:
+                    d.notes.append("ECC: corrected bit %d of %s" % (bit,"header" if k == 4 else "subpacket %d" % k))
+                elif r == hdmi_bch.UNCORRECTABLE:
+                    bad = True
+            if bad:
+                print("packet %d: bad ECC" % d.i)
                 print_hex_list(d.get_raw())
-                print(d.get_hb_body(),d.get_hb_ecc(),bch_ecc(d.get_hb_body()))
-                print(d.get_sb_body()[0],d.get_sb_ecc()[0],bch_ecc(d.get_sb_body()[0]))
-                print(d.get_sb_body()[1],d.get_sb_ecc()[0],bch_ecc(d.get_sb_body()[1]))
-                print(d.get_sb_body()[2],d.get_sb_ecc()[0],bch_ecc(d.get_sb_body()[2]))
-                print(d.get_sb_body()[3],d.get_sb_ecc()[0],bch_ecc(d.get_sb_body()[3]))
+                print(d.get_hb_body(),d.get_hb_ecc(),hdmi_bch.ecc(d.get_hb_body()))
+                for k in range(4):
+                    print(d.get_sb_body()[k],d.get_sb_ecc()[k],hdmi_bch.ecc(d.get_sb_body()[k]))
                 stop = True
                 break
+    print(bch.summary())
 
 if not stop and m_protocol == "HDMI":
     print("decoding and checking data island packets")
@@ -0,0 +1,437 @@
+################################################################################
+## tmds_dec.py                                                                ##
+## TMDS decode for the tmds_cap client.                                       ##
+################################################################################
+## (C) Copyright 2023 Adam Barnes <ambarnes@gmail.com>                        ##
+## This file is part of The Tyto Project. The Tyto Project is free software:  ##
+## you can redistribute it and/or modify it under the terms of the GNU Lesser ##
+## General Public License as published by the Free Software Foundation,       ##
+## either version 3 of the License, or (at your option) any later version.    ##
+## The Tyto Project is distributed in the hope that it will be useful, but    ##
+## WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY ##
+## or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public     ##
+## License for more details. You should have received a copy of the GNU       ##
+## Lesser General Public License along with The Tyto Project. If not, see     ##
+## https://www.gnu.org/licenses/.                                             ##
+################################################################################
+# Separates the channels of packed TMDS data (3 x 10 bits per pixel), works
+# out the period (control, preamble, guard band, video, data island) of every
+# pixel, and resolves syncs. The native library (see tmds_dec/tmds_dec.cpp)
+# does this in one pass; if it cannot be loaded, NumPy is used. Either way,
+# errors are reported by the NumPy decode, so that messages (and the partial
+# results left by an error) do not depend on which is used.
+# With the native library, a capture can also be decoded as it arrives from
+# the hardware (see Stream), so that decoding overlaps the download, or
+# split into chunks that are decoded on several cores at once (see
+# decode_parallel).
+
+# standard modules
+import os,sys,ctypes,array,concurrent.futures
+
+# third party
+import numpy as np
+
+# local package
+import spec
+
+# flag values for period type
+PERIOD_UNKNOWN          = 0
+PERIOD_CTRL             = 1
+PERIOD_VIDEO_PRE        = 2
+PERIOD_VIDEO_GB         = 4
+PERIOD_VIDEO            = 8
+PERIOD_DATA_PRE         = 16
+PERIOD_DATA_GB_LEADING  = 32 # used during prelim decode for *any* data guardband
+PERIOD_DATA_GB_TRAILING = 64
+PERIOD_DATA             = 128
+
+# lookup tables, indexed by 10 bit TMDS character
+TMDS_LUT_P = np.zeros((3,1024),dtype=np.uint8) # preliminary period flags per channel
+TMDS_LUT_C = np.full(1024,-1,dtype=np.int8) # C value (control characters), else -1
+TMDS_LUT_TERC4 = np.full(1024,-1,dtype=np.int8) # TERC4 value, else -1
+TMDS_LUT_VIDEO = np.array(spec.tmds.video,dtype=np.int16) # video value, else -1
+for i,c in enumerate(spec.tmds.ctrl):
+    TMDS_LUT_C[c] = i
+for i,c in enumerate(spec.tmds.terc4):
+    TMDS_LUT_TERC4[c] = i
+for ch in range(3):
+    TMDS_LUT_P[ch][TMDS_LUT_C >= 0] |= PERIOD_CTRL
+    TMDS_LUT_P[ch][spec.tmds.video_gb[ch]] |= PERIOD_VIDEO_GB
+    TMDS_LUT_P[ch][TMDS_LUT_VIDEO >= 0] |= PERIOD_VIDEO
+    TMDS_LUT_P[ch][TMDS_LUT_TERC4 >= 0] |= PERIOD_DATA
+    if ch > 0:
+        TMDS_LUT_P[ch][spec.tmds.data_gb] |= PERIOD_DATA_GB_LEADING | PERIOD_DATA_GB_TRAILING
+
+# decode arrays for n pixels, as decode_np() expects them:
+# (tmds,tmds_ch_p,tmds_c,tmds_p,tmds_sync)
+def alloc(n):
+    tmds,tmds_ch_p,tmds_c = [],[],[]
+    for ch in range(3):
+        tmds.append(array.array('h', bytes(2*n)))
+        tmds_ch_p.append(array.array('B', bytes([PERIOD_UNKNOWN])*n))
+        tmds_c.append(array.array('b', b'\xFF'*n))
+    return tmds,tmds_ch_p,tmds_c,array.array('B', bytes([PERIOD_UNKNOWN])*n),array.array('b', b'\xFF'*n)
+
+# set decode arrays back to their initial values (tmds is overwritten by any decode)
+def reset(tmds_ch_p,tmds_c,tmds_p,tmds_sync):
+    for ch in range(3):
+        np.frombuffer(tmds_ch_p[ch],dtype=np.uint8)[:] = PERIOD_UNKNOWN
+        np.frombuffer(tmds_c[ch],dtype=np.int8)[:] = -1
+    np.frombuffer(tmds_p,dtype=np.uint8)[:] = PERIOD_UNKNOWN
+    np.frombuffer(tmds_sync,dtype=np.int8)[:] = -1
+
+################################################################################
+# NumPy decode
+
+# decode packed (any 32 bit or wider integer buffer) into tmds[3], tmds_ch_p[3],
+# tmds_c[3], tmds_p and tmds_sync (array.array buffers of n pixels, set to
+# -1/PERIOD_UNKNOWN); return (m_start, hdmi, stop)
+def decode_np(packed,tmds,tmds_ch_p,tmds_c,tmds_p,tmds_sync):
+    n = len(tmds_p)
+    m_start = -1 # offset of first control pixel (start of valid data)
+    hdmi = False # C values other than 0 seen on channel 1 or 2
+    stop = False
+
+    print("separating TMDS channels")
+    packed_v = np.asarray(packed)[:n].astype(np.uint32) # respects item size of array/memoryview
+    for ch in range(3):
+        np.frombuffer(tmds[ch],dtype=np.int16)[:] = (packed_v >> (10*ch)) & 0x3FF
+
+    # numpy views of the decode arrays (shared memory)
+    tmds_v = [np.frombuffer(tmds[ch],dtype=np.int16) for ch in range(3)]
+    ch_p_v = [np.frombuffer(tmds_ch_p[ch],dtype=np.uint8) for ch in range(3)]
+    c_v = [np.frombuffer(tmds_c[ch],dtype=np.int8) for ch in range(3)]
+    p_v = np.frombuffer(tmds_p,dtype=np.uint8)
+    sync_v = np.frombuffer(tmds_sync,dtype=np.int8)
+
+    # first offset at which a (boolean) condition holds, else n
+    def first(m):
+        i = np.argmax(m)
+        return i if m[i] else len(m)
+
+    # first offset from i at which m is false, else len(m)
+    def run_end(m,i):
+        w = 64
+        while i < len(m):
+            s = m[i:i+w]
+            k = np.argmin(s)
+            if not s[k]:
+                return i+k
+            i += len(s)
+            w *= 2
+        return len(m)
+
+    print("preliminary period detection per channel")
+    for ch in range(3):
+        p = TMDS_LUT_P[ch][tmds_v[ch]]
+        e = first(p == 0)
+        ch_p_v[ch][:e] = p[:e]
+        c_v[ch][:e] = TMDS_LUT_C[tmds_v[ch][:e]]
+        if ch > 0 and np.any(c_v[ch][:e] > 0):
+            hdmi = True
+        if e < n:
+            print("error: illegal TMDS character (offset %d, channel %d)" % (e,ch)); stop = True; break
+
+    if not stop:
+        print("resolve control periods")
+        # control periods should begin and end together across all channels
+        ctrl = (ch_p_v[0] & ch_p_v[1] & ch_p_v[2] & PERIOD_CTRL) != 0 # control period across all
+        e = first(((ch_p_v[0] | ch_p_v[1] | ch_p_v[2]) & PERIOD_CTRL != 0) & ~ctrl)
+        p_v[:e][ctrl[:e]] = PERIOD_CTRL
+        s = first(ctrl[:e] & (c_v[1][:e] == 0) & (c_v[2][:e] == 0))
+        if s < e:
+            m_start = s
+        if e < n:
+            print("error: control period channel misalignment (offset %d)" % e); stop = True
+
+    if not stop:
+        print("detect preambles")
+        ctrl = (p_v & PERIOD_CTRL) != 0
+        cc1,cc2 = c_v[1],c_v[2] # channel C values
+        video_pre = ctrl & (cc1 == 1) & (cc2 == 0)
+        data_pre = ctrl & (cc1 == 1) & (cc2 == 1)
+        bad = ctrl & ~((cc1 == 0) & (cc2 == 0)) & ~video_pre & ~data_pre
+        i0 = max(m_start,0)
+        e = i0+first(bad[i0:])
+        p_v[i0:e][video_pre[i0:e]] |= PERIOD_VIDEO_PRE
+        p_v[i0:e][data_pre[i0:e]] |= PERIOD_DATA_PRE
+        if e < n:
+            print("error: illegal control period CTL value (offset %d, CTL[3:0] = %s%s)" % \
+                (e,format(cc2[e],'#04b')[2:],format(cc1[e],'#04b')[2:])); stop = True
+
+    if not stop:
+        print("check preambles and detect data islands")
+        # walk the preamble/guardband/data island state machine a run at a time
+        cp_and = ch_p_v[0] & ch_p_v[1] & ch_p_v[2]
+        is_pre = (p_v & (PERIOD_VIDEO_PRE | PERIOD_DATA_PRE)) != 0
+        is_vpre = (p_v & PERIOD_VIDEO_PRE) != 0
+        is_dpre = (p_v & PERIOD_DATA_PRE) != 0
+        is_vgb = (cp_and & PERIOD_VIDEO_GB) != 0
+        is_dgb = ((ch_p_v[0] & PERIOD_DATA) != 0) & ((ch_p_v[1] & ch_p_v[2] & PERIOD_DATA_GB_LEADING) != 0)
+        is_data = (cp_and & PERIOD_DATA) != 0
+        pre_i = np.flatnonzero(is_pre)
+        i = 0
+        while not stop:
+            # idle: find next preamble
+            j = np.searchsorted(pre_i,i)
+            if j == len(pre_i):
+                break
+            i = int(pre_i[j])
+            if is_vpre[i]:
+                k = run_end(is_vpre,i)
+                if k == n: break
+                if k-i != spec.hdmi.PRE_LEN:
+                    print("error: bad video preamble length (offset %d, length %d)" % (k,k-i)); stop = True; break
+                if not is_vgb[k]:
+                    print("error: expected video guardband after preamble (offset %d)" % k); stop = True; break
+                i,k = k,run_end(is_vgb,k)
+                p_v[i:k] |= PERIOD_VIDEO_GB
+                if k == n: break
+                if k-i != spec.hdmi.GB_LEN:
+                    print("error: bad video guardband length (offset %d, length %d)" % (k,k-i)); stop = True; break
+            else: # data preamble
+                k = run_end(is_dpre,i)
+                if k == n: break
+                if k-i != spec.hdmi.PRE_LEN:
+                    print("error: bad data preamble length (offset %d, length %d)" % (k,k-i)); stop = True; break
+                if not is_dgb[k]:
+                    print("error: expected data guardband after preamble (offset %d)" % k); stop = True; break
+                i,k = k,run_end(is_dgb,k)
+                p_v[i:k] |= PERIOD_DATA_GB_LEADING
+                if k == n: break
+                if k-i != spec.hdmi.GB_LEN:
+                    print("error: bad leading data guardband length (offset %d, length %d)" % (k,k-i)); stop = True; break
+                if not is_data[k]:
+                    print("error: expected TERC4 after leading data guardband (offset %d)" % k); stop = True; break
+                i,k = k,run_end(is_data,k)
+                p_v[i:k] |= PERIOD_DATA
+                if k == n: break
+                if (k-i) % spec.hdmi.PACKET_LEN != 0:
+                    print("error: non-integer multiple of data packets (offset %d, data length %d)" % (k,k-i)); stop = True; break
+                if (k-i) // spec.hdmi.PACKET_LEN > spec.hdmi.PACKET_MAX:
+                    print("error: too many consecutive data packets (offset %d)" % k); stop = True; break
+                if not is_dgb[k]:
+                    print("error: expected trailing data guardband after data (offset %d)" % k); stop = True; break
+                i,k = k,run_end(is_dgb,k)
+                p_v[i:k] |= PERIOD_DATA_GB_TRAILING
+                if k == n: break
+                if k-i != spec.hdmi.GB_LEN:
+                    print("error: bad trailing data guardband length (offset %d, length %d)" % (k,k-i)); stop = True; break
+                if not p_v[k] & PERIOD_CTRL:
+                    print("error: expected control period after data island (offset %d)" % k); stop = True; break
+            i = k+1 # the pixel that ends a guardband cannot start a preamble
+
+    if not stop:
+        print("detect video periods")
+        z = p_v == 0
+        e = first(z & ((ch_p_v[0] & ch_p_v[1] & ch_p_v[2] & PERIOD_VIDEO) == 0))
+        p_v[:e][z[:e]] = PERIOD_VIDEO
+        if e < n:
+            # this should be impossible
+            print("error: non-video characters found in video period (offset %d)" % e); stop = True
+
+    # assumption - sync states persist after control and data periods
+    if not stop:
+        print("resolve syncs")
+        ctrl = (p_v & PERIOD_CTRL) != 0
+        data = (p_v & (PERIOD_DATA | PERIOD_DATA_GB_LEADING | PERIOD_DATA_GB_TRAILING)) != 0
+        v = np.where(ctrl,c_v[0],TMDS_LUT_TERC4[tmds_v[0]] & 3).astype(np.int8)
+        k = np.where(ctrl | data,np.arange(n),-1)
+        np.maximum.accumulate(k,out=k) # last pixel that sets sync state
+        sync_v[:] = np.where(k >= 0,v[np.maximum(k,0)],-1)
+
+    return m_start,hdmi,stop
+
+################################################################################
+# native decode (see tmds_dec/tmds_dec.h)
+
+class _cfg_t(ctypes.Structure):
+    _fields_ = [('lut_p',ctypes.c_void_p),('lut_c',ctypes.c_void_p),('lut_terc4',ctypes.c_void_p),
+                ('pre_len',ctypes.c_int32),('gb_len',ctypes.c_int32),('packet_len',ctypes.c_int32),('packet_max',ctypes.c_int32)]
+
+class _out_t(ctypes.Structure):
+    _fields_ = [('tmds',ctypes.c_void_p*3),('ch_p',ctypes.c_void_p*3),('c',ctypes.c_void_p*3),
+                ('p',ctypes.c_void_p),('sync',ctypes.c_void_p)]
+
+class _state_t(ctypes.Structure):
+    _fields_ = [('next',ctypes.c_uint32),('st',ctypes.c_int32),('cnt',ctypes.c_int32),('start',ctypes.c_int32),
+                ('hdmi',ctypes.c_int32),('sync',ctypes.c_int32),('error',ctypes.c_int32)]
+
+# library: $TMDS_DEC_LIB, else as built by build/tmds_cap/tmds_dec/makefile
+def _load():
+    name = 'tmds_dec.dll' if sys.platform == 'win32' else 'libtmds_dec.so'
+    root = os.path.join(os.path.dirname(os.path.abspath(__file__)),*[os.pardir]*5)
+    for path in [os.environ.get('TMDS_DEC_LIB'),os.path.join(root,'build','tmds_cap','tmds_dec',name)]:
+        if path and os.path.exists(path):
+            try:
+                lib = ctypes.CDLL(path)
+            except OSError:
+                continue
+            lib.tmds_dec.restype = ctypes.c_int
+            lib.tmds_dec.argtypes = [ctypes.POINTER(_cfg_t),ctypes.c_void_p,ctypes.c_uint32,ctypes.POINTER(_out_t),
+                                     ctypes.POINTER(ctypes.c_int32),ctypes.POINTER(ctypes.c_int32)]
+            lib.tmds_dec_init.restype = None
+            lib.tmds_dec_init.argtypes = [ctypes.POINTER(_state_t)]
+            lib.tmds_dec_run.restype = ctypes.c_int
+            lib.tmds_dec_run.argtypes = [ctypes.POINTER(_cfg_t),ctypes.c_void_p,ctypes.c_uint32,ctypes.POINTER(_out_t),
+                                         ctypes.POINTER(_state_t)]
+            lib.tmds_dec_simd.restype = ctypes.c_char_p
+            return lib
+    return None
+
+lib = _load()
+simd = lib.tmds_dec_simd().decode() if lib else None
+
+_cfg = _cfg_t(TMDS_LUT_P.ctypes.data,TMDS_LUT_C.ctypes.data,TMDS_LUT_TERC4.ctypes.data,
+    spec.hdmi.PRE_LEN,spec.hdmi.GB_LEN,spec.hdmi.PACKET_LEN,spec.hdmi.PACKET_MAX)
+
+def _addr(a):
+    return a.buffer_info()[0]
+
+def _out(tmds,tmds_ch_p,tmds_c,tmds_p,tmds_sync):
+    return _out_t((ctypes.c_void_p*3)(*map(_addr,tmds)),(ctypes.c_void_p*3)(*map(_addr,tmds_ch_p)),
+        (ctypes.c_void_p*3)(*map(_addr,tmds_c)),_addr(tmds_p),_addr(tmds_sync))
+
+# as decode_np(), in one native pass; return None if the decode stopped on an error
+def decode_native(packed,tmds,tmds_ch_p,tmds_c,tmds_p,tmds_sync):
+    n = len(tmds_p)
+    packed_v = np.ascontiguousarray(np.asarray(packed)[:n],dtype=np.uint32)
+    out = _out(tmds,tmds_ch_p,tmds_c,tmds_p,tmds_sync)
+    m_start,hdmi = ctypes.c_int32(-1),ctypes.c_int32(0)
+    if lib.tmds_dec(ctypes.byref(_cfg),packed_v.ctypes.data,n,ctypes.byref(out),ctypes.byref(m_start),ctypes.byref(hdmi)):
+        return None
+    return m_start.value,bool(hdmi.value),False
+
+################################################################################
+# parallel decode (native library only)
+
+# A pixel that follows a plain control pixel (C = 0 on channels 1 and 2, as
+# outside preambles) always finds the state machine idle: any preamble, guard
+# band or data island before it has either ended or been found in error. So
+# the capture can be split at any two such pixels in a row (a pre-scan of the
+# packed data finds them in blanking, near evenly spaced points), and the
+# chunks decoded independently, each from the idle state. Sync state needs no
+# stitching either: the pixel at each seam is a control pixel, which sets it.
+
+SPLIT_SCAN = 1 << 16 # pixels searched for a split point (several lines of any format)
+
+# split points of n pixels into (up to) k chunks: [0, ..., n]
+def splits(packed_v,k):
+    n = len(packed_v)
+    c0 = spec.tmds.ctrl[0]
+    r = [0]
+    for t in range(1,k):
+        i = max(n*t//k,r[-1]+1)
+        w = packed_v[i-1:i+SPLIT_SCAN]
+        ok = (((w >> 10) & 0x3FF) == c0) & (((w >> 20) & 0x3FF) == c0) & (TMDS_LUT_C[w & 0x3FF] >= 0)
+        j = np.flatnonzero(ok[:-1] & ok[1:])
+        if len(j) and i+j[0] < n:
+            r.append(i+int(j[0]))
+    return r+[n]
+
+# as decode_native(), on up to threads cores (the native library releases the
+# interpreter lock, so the chunks share the decode arrays in place)
+def decode_parallel(packed,tmds,tmds_ch_p,tmds_c,tmds_p,tmds_sync,threads):
+    n = len(tmds_p)
+    packed_v = np.ascontiguousarray(np.asarray(packed)[:n],dtype=np.uint32)
+    out = _out(tmds,tmds_ch_p,tmds_c,tmds_p,tmds_sync)
+    s = splits(packed_v,threads)
+    def chunk(a,b):
+        st = _state_t()
+        lib.tmds_dec_init(ctypes.byref(st))
+        st.next = a
+        lib.tmds_dec_run(ctypes.byref(_cfg),packed_v.ctypes.data,b,ctypes.byref(out),ctypes.byref(st))
+        return st
+    with concurrent.futures.ThreadPoolExecutor(len(s)-1) as pool:
+        r = list(pool.map(chunk,s[:-1],s[1:]))
+    m_start = next((st.start for st in r if st.start >= 0),-1)
+    if any(st.error for st in r) or m_start < 0:
+        return None
+    return m_start,any(st.hdmi for st in r),False
+
+# decode with the backend given ('native', 'numpy', or 'auto' for native if
+# available); the native decode may be split across threads
+def decode(packed,tmds,tmds_ch_p,tmds_c,tmds_p,tmds_sync,backend='auto',threads=1):
+    if backend == 'native' or (backend == 'auto' and lib):
+        if threads > 1:
+            print("decoding (native, SIMD: %s, %d threads)" % (simd,threads))
+            r = decode_parallel(packed,tmds,tmds_ch_p,tmds_c,tmds_p,tmds_sync,threads)
+        else:
+            print("decoding (native, SIMD: %s)" % simd)
+            r = decode_native(packed,tmds,tmds_ch_p,tmds_c,tmds_p,tmds_sync)
+        if r:
+            return r
+        print("decode error: decoding again with NumPy to report it")
+        reset(tmds_ch_p,tmds_c,tmds_p,tmds_sync)
+    return decode_np(packed,tmds,tmds_ch_p,tmds_c,tmds_p,tmds_sync)
+
+################################################################################
+# pipelined decode (native library only)
+
+# Decodes a capture of n pixels as it arrives: the receiver puts pixels into
+# packed (in order), and calls run() with the number present so far; the
+# native state machine carries on from where the last call left off. Once a
+# frame has been decoded, its timing is printed (an early look: the full
+# analysis checks every frame once the capture is complete). finish() decodes
+# whatever is left, and returns as decode() does; if the decode stopped on an
+# error, the NumPy decode is run over the whole capture to report it.
+class Stream:
+    MIN_PIXELS = 1 << 16 # least pixels per native call (except the last)
+
+    def __init__(self,n):
+        self.n = n
+        self.packed = np.zeros(n,dtype=np.uint32)
+        self.tmds,self.tmds_ch_p,self.tmds_c,self.tmds_p,self.tmds_sync = alloc(n)
+        self._out = _out(self.tmds,self.tmds_ch_p,self.tmds_c,self.tmds_p,self.tmds_sync)
+        self._state = _state_t()
+        lib.tmds_dec_init(ctypes.byref(self._state))
+        self._p_v = np.frombuffer(self.tmds_p,dtype=np.uint8)
+        self._sync_v = np.frombuffer(self.tmds_sync,dtype=np.int8)
+        self._vs = [] # v sync edges seen (until timing is printed)
+        print("decoding as data arrives (native, SIMD: %s)" % simd)
+
+    # decode pixels up to end (exclusive)
+    def run(self,end):
+        s = self._state
+        i = s.next
+        if s.error or end-i < (self.MIN_PIXELS if end < self.n else 1):
+            return
+        if lib.tmds_dec_run(ctypes.byref(_cfg),self.packed.ctypes.data,end,ctypes.byref(self._out),ctypes.byref(s)):
+            return
+        if self._vs is not None:
+            self._timing(i,end)
+
+    # look for v sync edges in pixels i..end-1, print timing once a frame is seen
+    def _timing(self,i,end):
+        v = self._sync_v[max(i-1,0):end]
+        e = np.flatnonzero((v[1:] >= 0) & (v[:-1] >= 0) & (((v[1:] ^ v[:-1]) & 2) != 0))
+        self._vs += (e+max(i-1,0)+1).tolist()
+        if len(self._vs) < 3:
+            return
+        e0,e1,e2 = self._vs[:3]
+        self._vs = None
+        sync = self._sync_v[e0:e2]
+        hs = (sync & 1) != 0
+        h = np.flatnonzero(hs[1:] & ~hs[:-1]) # h sync rising edges
+        if len(h) < 2:
+            return
+        h_total = int(np.median(np.diff(h)))
+        h_pol = np.count_nonzero(hs) < len(hs)//2 # sync pulse is the shorter state
+        h_sync = (np.count_nonzero(hs) if h_pol else len(hs)-np.count_nonzero(hs))*h_total//(e2-e0)
+        v_pol = (e1-e0 < e2-e1) == bool(sync[0] & 2)
+        v_sync = min(e1-e0,e2-e1)/h_total
+        video = (self._p_v[e0:e2] & PERIOD_VIDEO) != 0
+        lines = np.count_nonzero(video[1:] & ~video[:-1])+int(video[0])
+        print("early timing (from pixels %d..%d, not yet checked): %d pixels (%.1f lines) per frame, "
+              "h total %d active %d sync %d (%s), v active %d sync %g (%s)" % (e0,e2-1,e2-e0,(e2-e0)/h_total,
+              h_total,np.count_nonzero(video)//max(lines,1),h_sync,"+" if h_pol else "-",lines,v_sync,"+" if v_pol else "-"))
+
+    # finish decoding, return (m_start, hdmi, stop)
+    def finish(self):
+        s = self._state
+        self.run(self.n)
+        if not s.error and s.start >= 0:
+            return s.start,bool(s.hdmi),False
+        print("decode error: decoding again with NumPy to report it")
+        reset(self.tmds_ch_p,self.tmds_c,self.tmds_p,self.tmds_sync)
+        return decode_np(self.packed,self.tmds,self.tmds_ch_p,self.tmds_c,self.tmds_p,self.tmds_sync)
@@ -0,0 +1,277 @@
+// tmds_dec.cpp
+// Native TMDS decode for the tmds_cap client: the same decode as the NumPy
+// passes in tmds_dec.py, fused into one pass. The capture is processed a
+// block at a time: the channels of a block are unpacked with SIMD shifts and
+// masks, then each pixel is classified (with 1 KiB lookup tables, which stay
+// in L1 cache) and run through the period state machine while the block is
+// still in cache. The state machine is sequential, so only unpacking is
+// vectorised.
+// On any error, decoding stops: tmds_dec.py then runs the NumPy decode to
+// report the error exactly as it always has.
+
+#include <stdint.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "tmds_dec.h"
+
+namespace {
+
+const uint32_t BLOCK = 4096; // pixels per block (30 KiB of output)
+
+enum state_t {
+    S_IDLE,
+    S_VIDEO_PRE,
+    S_VIDEO_GB,
+    S_DATA_PRE,
+    S_DATA_GB_LEADING,
+    S_DATA,
+    S_DATA_GB_TRAILING
+};
+
+// unpack pixels i..end-1 to 3 channels of 16 bit characters
+void unpack(const uint32_t *packed, uint32_t i, uint32_t end, int16_t *const *tmds)
+{
+    int ch;
+
+#if defined(__AVX2__)
+    // 16 pixels at a time
+    const __m256i m = _mm256_set1_epi32(0x3FF);
+    __m256i a, b, x;
+    for (; i+16 <= end; i += 16) {
+        a = _mm256_loadu_si256((const __m256i *)(packed+i));
+        b = _mm256_loadu_si256((const __m256i *)(packed+i+8));
+        for (ch = 0; ch < 3; ch++) {
+            x = _mm256_packs_epi32(_mm256_and_si256(a, m), _mm256_and_si256(b, m)); // a0..3 b0..3 a4..7 b4..7
+            x = _mm256_permute4x64_epi64(x, 0xD8);
+            _mm256_storeu_si256((__m256i *)(tmds[ch]+i), x);
+            a = _mm256_srli_epi32(a, 10);
+            b = _mm256_srli_epi32(b, 10);
+        }
+    }
+#elif defined(__SSE2__)
+    // 8 pixels at a time
+    const __m128i m = _mm_set1_epi32(0x3FF);
+    __m128i a, b;
+    for (; i+8 <= end; i += 8) {
+        a = _mm_loadu_si128((const __m128i *)(packed+i));
+        b = _mm_loadu_si128((const __m128i *)(packed+i+4));
+        for (ch = 0; ch < 3; ch++) {
+            _mm_storeu_si128((__m128i *)(tmds[ch]+i), _mm_packs_epi32(_mm_and_si128(a, m), _mm_and_si128(b, m)));
+            a = _mm_srli_epi32(a, 10);
+            b = _mm_srli_epi32(b, 10);
+        }
+    }
+#endif
+    for (; i < end; i++)
+        for (ch = 0; ch < 3; ch++)
+            tmds[ch][i] = (packed[i] >> (10*ch)) & 0x3FF;
+}
+
+} // namespace
+
+extern "C" void tmds_dec_init(tmds_dec_state_t *s)
+{
+    s->next = 0;
+    s->st = S_IDLE;
+    s->cnt = 0;
+    s->start = -1;
+    s->hdmi = 0;
+    s->sync = -1;
+    s->error = 0;
+}
+
+extern "C" int tmds_dec_run(const tmds_dec_cfg_t *cfg, const uint32_t *packed, uint32_t n,
+    const tmds_dec_out_t *out, tmds_dec_state_t *s)
+{
+    const uint8_t *lut_p[3] = { cfg->lut_p, cfg->lut_p+1024, cfg->lut_p+2048 };
+    state_t st = (state_t)s->st;
+    int32_t cnt = s->cnt;
+    int32_t start = s->start;
+    int any_c = s->hdmi;
+    int8_t sync = s->sync;
+    uint32_t b, i, end;
+    int ch;
+
+    if (s->error)
+        return TMDS_DEC_ERROR;
+    s->error = 1; // until done
+    for (b = s->next; b < n; b = end) {
+        end = n-b > BLOCK ? b+BLOCK : n;
+        unpack(packed, b, end, out->tmds);
+        for (i = b; i < end; i++) {
+            uint8_t cp[3], cpa, p = 0;
+            int8_t c[3];
+
+            // preliminary period detection per channel
+            for (ch = 0; ch < 3; ch++) {
+                uint16_t q = out->tmds[ch][i];
+                cp[ch] = lut_p[ch][q];
+                c[ch] = cfg->lut_c[q];
+                if (!cp[ch])
+                    return TMDS_DEC_ERROR; // illegal character
+                out->ch_p[ch][i] = cp[ch];
+                out->c[ch][i] = c[ch];
+            }
+            any_c |= (c[1] > 0) | (c[2] > 0);
+            cpa = cp[0] & cp[1] & cp[2];
+
+            // control periods begin and end together across all channels
+            if ((cp[0] | cp[1] | cp[2]) & TMDS_DEC_CTRL) {
+                if (!(cpa & TMDS_DEC_CTRL))
+                    return TMDS_DEC_ERROR; // misalignment
+                p = TMDS_DEC_CTRL;
+                if (start < 0 && c[1] == 0 && c[2] == 0)
+                    start = i;
+            }
+
+            // preambles (from start of valid data)
+            if (start >= 0 && (p & TMDS_DEC_CTRL)) {
+                if (c[1] == 0 && c[2] == 0)
+                    ; // normal control period
+                else if (c[1] == 1 && c[2] == 0)
+                    p |= TMDS_DEC_VIDEO_PRE;
+                else if (c[1] == 1 && c[2] == 1)
+                    p |= TMDS_DEC_DATA_PRE;
+                else
+                    return TMDS_DEC_ERROR; // illegal CTL value
+            }
+
+            // check preambles and detect data islands
+            int gb = (cp[0] & TMDS_DEC_DATA) && (cp[1] & cp[2] & TMDS_DEC_DATA_GB_LEADING);
+            switch (st) {
+                case S_VIDEO_PRE:
+                    if (p & TMDS_DEC_VIDEO_PRE)
+                        cnt++;
+                    else if (cnt != cfg->pre_len || !(cpa & TMDS_DEC_VIDEO_GB))
+                        return TMDS_DEC_ERROR;
+                    else {
+                        p |= TMDS_DEC_VIDEO_GB;
+                        st = S_VIDEO_GB;
+                        cnt = 1;
+                    }
+                    break;
+                case S_VIDEO_GB:
+                    if (cpa & TMDS_DEC_VIDEO_GB) {
+                        p |= TMDS_DEC_VIDEO_GB;
+                        cnt++;
+                    }
+                    else if (cnt != cfg->gb_len)
+                        return TMDS_DEC_ERROR;
+                    else {
+                        st = S_IDLE;
+                        cnt = 0;
+                    }
+                    break;
+                case S_DATA_PRE:
+                    if (p & TMDS_DEC_DATA_PRE)
+                        cnt++;
+                    else if (cnt != cfg->pre_len || !gb)
+                        return TMDS_DEC_ERROR;
+                    else {
+                        p |= TMDS_DEC_DATA_GB_LEADING;
+                        st = S_DATA_GB_LEADING;
+                        cnt = 1;
+                    }
+                    break;
+                case S_DATA_GB_LEADING:
+                    if (gb) {
+                        p |= TMDS_DEC_DATA_GB_LEADING;
+                        cnt++;
+                    }
+                    else if (cnt != cfg->gb_len || !(cpa & TMDS_DEC_DATA))
+                        return TMDS_DEC_ERROR;
+                    else {
+                        p |= TMDS_DEC_DATA;
+                        st = S_DATA;
+                        cnt = 1;
+                    }
+                    break;
+                case S_DATA:
+                    if (cpa & TMDS_DEC_DATA) {
+                        p |= TMDS_DEC_DATA;
+                        cnt++;
+                    }
+                    else if (cnt % cfg->packet_len || cnt / cfg->packet_len > cfg->packet_max || !gb)
+                        return TMDS_DEC_ERROR;
+                    else {
+                        p |= TMDS_DEC_DATA_GB_TRAILING;
+                        st = S_DATA_GB_TRAILING;
+                        cnt = 1;
+                    }
+                    break;
+                case S_DATA_GB_TRAILING:
+                    if (gb) {
+                        p |= TMDS_DEC_DATA_GB_TRAILING;
+                        cnt++;
+                    }
+                    else if (cnt != cfg->gb_len || !(p & TMDS_DEC_CTRL))
+                        return TMDS_DEC_ERROR;
+                    else {
+                        st = S_IDLE;
+                        cnt = 0;
+                    }
+                    break;
+                default:
+                    if (p & TMDS_DEC_VIDEO_PRE) {
+                        st = S_VIDEO_PRE;
+                        cnt = 1;
+                    }
+                    else if (p & TMDS_DEC_DATA_PRE) {
+                        st = S_DATA_PRE;
+                        cnt = 1;
+                    }
+                    break;
+            }
+
+            // everything else is video
+            if (!p) {
+                if (!(cpa & TMDS_DEC_VIDEO))
+                    return TMDS_DEC_ERROR;
+                p = TMDS_DEC_VIDEO;
+            }
+            out->p[i] = p;
+
+            // sync states persist after control and data periods
+            if (p & TMDS_DEC_CTRL)
+                sync = c[0];
+            else if (p & (TMDS_DEC_DATA | TMDS_DEC_DATA_GB_LEADING | TMDS_DEC_DATA_GB_TRAILING))
+                sync = cfg->lut_terc4[out->tmds[0][i]] & 3;
+            out->sync[i] = sync;
+        }
+    }
+    s->next = n;
+    s->st = st;
+    s->cnt = cnt;
+    s->start = start;
+    s->hdmi = any_c;
+    s->sync = sync;
+    s->error = 0;
+    return TMDS_DEC_OK;
+}
+
+extern "C" int tmds_dec(const tmds_dec_cfg_t *cfg, const uint32_t *packed, uint32_t n,
+    const tmds_dec_out_t *out, int32_t *m_start, int32_t *hdmi)
+{
+    tmds_dec_state_t s;
+
+    tmds_dec_init(&s);
+    if (tmds_dec_run(cfg, packed, n, out, &s) != TMDS_DEC_OK || s.start < 0)
+        return TMDS_DEC_ERROR; // (NumPy decode also examines pixels before the start)
+    *m_start = s.start;
+    *hdmi = s.hdmi;
+    return TMDS_DEC_OK;
+}
+
+extern "C" const char *tmds_dec_simd(void)
+{
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__)
+    return "SSE2";
+#else
+    return "none";
+#endif
+}
@@ -0,0 +1,76 @@
+// tmds_dec.h
+// Native TMDS decode for the tmds_cap client (see tmds_dec.py).
+
+#ifndef _TMDS_DEC_H_
+#define _TMDS_DEC_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// period flags (as tmds_dec.py)
+#define TMDS_DEC_CTRL             1
+#define TMDS_DEC_VIDEO_PRE        2
+#define TMDS_DEC_VIDEO_GB         4
+#define TMDS_DEC_VIDEO            8
+#define TMDS_DEC_DATA_PRE         16
+#define TMDS_DEC_DATA_GB_LEADING  32
+#define TMDS_DEC_DATA_GB_TRAILING 64
+#define TMDS_DEC_DATA             128
+
+// return values
+#define TMDS_DEC_OK    0
+#define TMDS_DEC_ERROR 1 // decode error (or, from tmds_dec(), no start of valid data): outputs are incomplete
+
+// lookup tables (indexed by 10 bit character) and HDMI period lengths
+typedef struct {
+    const uint8_t *lut_p;     // [3][1024] preliminary period flags per channel
+    const int8_t  *lut_c;     // [1024] C value, else -1
+    const int8_t  *lut_terc4; // [1024] TERC4 value, else -1
+    int32_t pre_len;          // preamble
+    int32_t gb_len;           // guard band
+    int32_t packet_len;       // data island packet
+    int32_t packet_max;       // consecutive packets
+} tmds_dec_cfg_t;
+
+// output arrays, n pixels each
+typedef struct {
+    int16_t *tmds[3];         // characters per channel
+    uint8_t *ch_p[3];         // preliminary period flags per channel
+    int8_t  *c[3];            // C value per channel, else -1
+    uint8_t *p;               // period flags
+    int8_t  *sync;            // bit 0 = h sync, bit 1 = v sync, -1 = unknown
+} tmds_dec_out_t;
+
+// decode state, carried from one call of tmds_dec_run() to the next
+typedef struct {
+    uint32_t next;            // next pixel to decode
+    int32_t  st;              // state machine state
+    int32_t  cnt;             // length of current preamble, guard band or data
+    int32_t  start;           // offset of first control pixel (with C = 0 on channels 1 and 2), else -1
+    int32_t  hdmi;            // nonzero if C values other than 0 are seen on channels 1 or 2
+    int32_t  sync;            // current sync state
+    int32_t  error;           // decode stopped on an error
+} tmds_dec_state_t;
+
+void tmds_dec_init(tmds_dec_state_t *s);
+
+// decode packed pixels s->next..end-1 (3 x 10 bits each), so that a capture
+// can be decoded as it arrives; packed and out cover the whole capture
+int tmds_dec_run(const tmds_dec_cfg_t *cfg, const uint32_t *packed, uint32_t end,
+    const tmds_dec_out_t *out, tmds_dec_state_t *s);
+
+// decode n packed pixels in one pass
+int tmds_dec(const tmds_dec_cfg_t *cfg, const uint32_t *packed, uint32_t n,
+    const tmds_dec_out_t *out, int32_t *m_start, int32_t *hdmi);
+
+// SIMD instruction set used to unpack channels ("AVX2", "SSE2" or "none")
+const char *tmds_dec_simd(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,65 @@
+################################################################################
+## tmds_dec_bench.py                                                          ##
+## Benchmark of serial and parallel TMDS decode (see tmds_dec.py).           ##
+################################################################################
+## (C) Copyright 2023 Adam Barnes <ambarnes@gmail.com>                        ##
+## This file is part of The Tyto Project. The Tyto Project is free software:  ##
+## you can redistribute it and/or modify it under the terms of the GNU Lesser ##
+## General Public License as published by the Free Software Foundation,       ##
+## either version 3 of the License, or (at your option) any later version.    ##
+## The Tyto Project is distributed in the hope that it will be useful, but    ##
+## WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY ##
+## or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public     ##
+## License for more details. You should have received a copy of the GNU       ##
+## Lesser General Public License along with The Tyto Project. If not, see     ##
+## https://www.gnu.org/licenses/.                                             ##
+################################################################################
+# Decodes a raw capture (as written by tmds_cap.py -o) serially, then split
+# across each given number of threads, checks that every parallel decode
+# matches the serial one exactly, and reports the times.
+
+# standard modules
+import sys,os,argparse,time
+
+# third party
+import numpy as np
+
+# local modules
+import tmds_dec
+import tmds_raw
+
+parser = argparse.ArgumentParser(description='Benchmark of serial and parallel TMDS decode')
+parser.add_argument('file',help='raw TMDS data file (as written by tmds_cap.py -o)')
+parser.add_argument('-j',metavar='THREADS',default='2,4,8,0',help='comma separated thread counts to try (0 = all cores) (default: %(default)s)')
+parser.add_argument('-x',type=int,metavar='COPIES',default=1,help='decode this many copies of the capture, end to end (default: %(default)s)')
+parser.add_argument('-t',type=int,metavar='TRIES',default=3,help='best of this many decodes (default: %(default)s)')
+args = parser.parse_args()
+if not tmds_dec.lib:
+    sys.exit("native decoder library not found (build it with build/tmds_cap/tmds_dec/makefile, or set TMDS_DEC_LIB)")
+
+raw,payload = tmds_raw.read(args.file)
+if raw.packing != tmds_raw.SPARSE:
+    sys.exit("dense raw captures are not supported")
+packed = np.tile(np.frombuffer(payload,dtype='<u4'),args.x)
+n = len(packed)
+print("%d pixels, SIMD: %s, %d cores" % (n,tmds_dec.simd,os.cpu_count()))
+
+# best time and results of decode with the given thread count
+def run(threads):
+    best = None
+    for _ in range(args.t):
+        a = tmds_dec.alloc(n)
+        t0 = time.perf_counter()
+        r = tmds_dec.decode_parallel(packed,*a,threads) if threads > 1 else tmds_dec.decode_native(packed,*a)
+        t = time.perf_counter()-t0
+        best = t if best is None or t < best else best
+    return best,r,[x.tobytes() for x in a[0]+a[1]+a[2]+[a[3],a[4]]]
+
+t1,r1,a1 = run(1)
+if r1 is None:
+    sys.exit("decode error (see tmds_cap.py -i %s)" % args.file)
+print("serial:     %7.3f s  %6.1f Mpixels/s" % (t1,n/t1/1e6))
+for threads in [int(j) or os.cpu_count() for j in args.j.split(',')]:
+    t,r,a = run(threads)
+    print("%2d threads: %7.3f s  %6.1f Mpixels/s  x%.2f  %d chunks  %s" % (threads,t,n/t/1e6,t1/t,
+        len(tmds_dec.splits(packed,threads))-1,"identical" if (r,a) == (r1,a1) else "MISMATCH"))
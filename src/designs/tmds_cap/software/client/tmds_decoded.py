@@ -0,0 +1,167 @@
+################################################################################
+## tmds_decoded.py                                                            ##
+## Decoded TMDS capture file format for the tmds_cap client.                  ##
+################################################################################
+## (C) Copyright 2023 Adam Barnes <ambarnes@gmail.com>                        ##
+## This file is part of The Tyto Project. The Tyto Project is free software:  ##
+## you can redistribute it and/or modify it under the terms of the GNU Lesser ##
+## General Public License as published by the Free Software Foundation,       ##
+## either version 3 of the License, or (at your option) any later version.    ##
+## The Tyto Project is distributed in the hope that it will be useful, but    ##
+## WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY ##
+## or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public     ##
+## License for more details. You should have received a copy of the GNU       ##
+## Lesser General Public License along with The Tyto Project. If not, see     ##
+## https://www.gnu.org/licenses/.                                             ##
+################################################################################
+# A decoded capture file is a fixed header (HEADER, then a SECTION entry per
+# section, padded to PAGE bytes), then the sections, each starting on a page
+# boundary: the decode arrays (as tmds_dec.py makes them), and an index of the
+# capture: the pixel offset of the leading edge of every h sync and v sync
+# pulse, and the offset and length of the data period of every data island.
+# A reader maps the file into memory and only touches the pages it uses, so
+# that (for example) one line of one frame can be found and inspected at once
+# however big the capture is.
+# Run this module to list a file's index, or to show a line of a frame.
+
+# standard modules
+import sys,os,struct,mmap,argparse
+
+# third party
+import numpy as np
+
+# local package
+import spec
+
+# local modules
+from tmds_dec import PERIOD_CTRL,PERIOD_VIDEO_PRE,PERIOD_VIDEO_GB,PERIOD_VIDEO, \
+    PERIOD_DATA_PRE,PERIOD_DATA_GB_LEADING,PERIOD_DATA_GB_TRAILING,PERIOD_DATA
+
+MAGIC   = b'TMDSDEC\0'
+VERSION = 1
+PAGE    = 4096
+
+# magic, version, pixels, m_start (-1 = none), HDMI, sync polarity (POL_xxx), sections
+HEADER  = struct.Struct('<8sLLiLLL')
+SECTION = struct.Struct('<8sQQ') # name, offset, bytes
+
+POL_H = 1<<0 # h sync pulse is high
+POL_V = 1<<1 # v sync pulse is high
+
+# sections: name, memoryview format
+SECTIONS = [('tmds%d' % ch,'h') for ch in range(3)]+[('ch_p%d' % ch,'B') for ch in range(3)]+ \
+    [('c%d' % ch,'b') for ch in range(3)]+[('p','B'),('sync','b'),('hsync','I'),('vsync','I'),('island','I')]
+
+# index of a capture from its period flags and sync states: return sync
+# polarity, h and v sync leading edges, and data islands (offset, length)
+def index(tmds_p,tmds_sync):
+    p = np.frombuffer(tmds_p,dtype=np.uint8)
+    sync = np.frombuffer(tmds_sync,dtype=np.int8)
+    known = (sync[1:] >= 0) & (sync[:-1] >= 0)
+    pol = 0
+    edges = []
+    for bit,flag in [(1,POL_H),(2,POL_V)]:
+        s = (sync & bit) != 0
+        k = s[sync >= 0]
+        high = np.count_nonzero(k) < len(k)-np.count_nonzero(k) # pulse is the shorter state
+        if high:
+            pol |= flag
+        else:
+            s = ~s
+        edges.append((np.flatnonzero(known & s[1:] & ~s[:-1])+1).astype(np.uint32))
+    d = np.concatenate(([False],(p & PERIOD_DATA) != 0,[False]))
+    i = np.flatnonzero(d[1:] & ~d[:-1])
+    e = np.flatnonzero(~d[1:] & d[:-1])
+    island = np.stack((i,e-i),axis=1).astype(np.uint32)
+    return pol,edges[0],edges[1],island
+
+# write a decoded capture and its index; the arrays are written as they are, without copies
+def write(path,n,m_start,hdmi,tmds,tmds_ch_p,tmds_c,tmds_p,tmds_sync):
+    pol,hsync,vsync,island = index(tmds_p,tmds_sync)
+    data = list(tmds)+list(tmds_ch_p)+list(tmds_c)+[tmds_p,tmds_sync,hsync,vsync,island]
+    data = [memoryview(a).cast('B') for a in data]
+    offset = PAGE*(1+(HEADER.size+SECTION.size*len(SECTIONS)-1)//PAGE)
+    h = HEADER.pack(MAGIC,VERSION,n,m_start,1 if hdmi else 0,pol,len(SECTIONS))
+    for (name,_),b in zip(SECTIONS,data):
+        h += SECTION.pack(name.encode(),offset,len(b))
+        offset += PAGE*((len(b)+PAGE-1)//PAGE)
+    with open(path,'wb',buffering=0) as f:
+        f.write(h+bytes(-len(h) % PAGE))
+        for b in data:
+            i = 0
+            while i < len(b):
+                i += f.write(b[i:])
+            f.write(bytes(-len(b) % PAGE))
+
+# a decoded capture file, mapped: the decode arrays are memoryviews (indexed
+# as the arrays they were written from), the index arrays are NumPy arrays
+class Decoded:
+    def __init__(self,path):
+        with open(path,'rb') as f:
+            m = mmap.mmap(f.fileno(),0,access=mmap.ACCESS_READ)
+        magic,version,self.n,self.m_start,self.hdmi,self.pol,ns = HEADER.unpack_from(m)
+        if magic != MAGIC:
+            raise ValueError("not a decoded TMDS capture file")
+        if version != VERSION:
+            raise ValueError("unsupported decoded TMDS capture file version (%d)" % version)
+        mv = memoryview(m)
+        fmt = dict(SECTIONS)
+        sec = {}
+        for k in range(ns):
+            name,offset,nb = SECTION.unpack_from(m,HEADER.size+k*SECTION.size)
+            name = name.rstrip(b'\0').decode()
+            if offset+nb > len(m):
+                raise ValueError("decoded TMDS capture file is truncated")
+            if name in fmt:
+                sec[name] = mv[offset:offset+nb].cast(fmt[name])
+        self.tmds = [sec['tmds%d' % ch] for ch in range(3)]
+        self.tmds_ch_p = [sec['ch_p%d' % ch] for ch in range(3)]
+        self.tmds_c = [sec['c%d' % ch] for ch in range(3)]
+        self.tmds_p = sec['p']
+        self.tmds_sync = sec['sync']
+        self.hsync = np.frombuffer(sec['hsync'],dtype=np.uint32)
+        self.vsync = np.frombuffer(sec['vsync'],dtype=np.uint32)
+        self.island = np.frombuffer(sec['island'],dtype=np.uint32).reshape(-1,2)
+
+    # pixel range (start, end) of a line of a frame: line 0 starts at the
+    # first h sync leading edge at or after the frame's v sync leading edge
+    def line(self,frame,line):
+        if frame >= len(self.vsync):
+            raise IndexError("frame %d not in capture (%d v syncs)" % (frame,len(self.vsync)))
+        k = int(np.searchsorted(self.hsync,self.vsync[frame]))+line
+        if k+1 >= len(self.hsync):
+            raise IndexError("line %d of frame %d not in capture" % (line,frame))
+        return int(self.hsync[k]),int(self.hsync[k+1])
+
+PERIOD_NAMES = [(PERIOD_CTRL,'control'),(PERIOD_VIDEO_PRE,'video preamble'),(PERIOD_VIDEO_GB,'video guard band'),
+    (PERIOD_VIDEO,'video'),(PERIOD_DATA_PRE,'data preamble'),(PERIOD_DATA_GB_LEADING,'leading data guard band'),
+    (PERIOD_DATA_GB_TRAILING,'trailing data guard band'),(PERIOD_DATA,'data island')]
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Index of a decoded TMDS capture file (as written by tmds_cap.py -w)')
+    parser.add_argument('file',help='decoded TMDS capture file')
+    parser.add_argument('-f',type=int,metavar='FRAME',default=None,help='frame (from first v sync leading edge)')
+    parser.add_argument('-l',type=int,metavar='LINE',default=0,help='line of frame: list its periods (default: %(default)s)')
+    args = parser.parse_args()
+    try:
+        d = Decoded(args.file)
+    except ValueError as e:
+        sys.exit(e)
+    print("%d pixels (%s), start at %d, h sync %s, v sync %s" % (d.n,"HDMI" if d.hdmi else "DVI",d.m_start,
+        "+" if d.pol & POL_H else "-","+" if d.pol & POL_V else "-"))
+    print("%d h syncs, %d v syncs, %d data islands" % (len(d.hsync),len(d.vsync),len(d.island)))
+    for k,v in enumerate(d.vsync):
+        print("frame %d: v sync at %d, %d lines" % (k,v,
+            np.searchsorted(d.hsync,d.vsync[k+1] if k+1 < len(d.vsync) else d.n)-np.searchsorted(d.hsync,v)))
+    if args.f is not None:
+        try:
+            start,end = d.line(args.f,args.l)
+        except IndexError as e:
+            sys.exit(e)
+        print("frame %d line %d: pixels %d..%d" % (args.f,args.l,start,end-1))
+        p = np.frombuffer(d.tmds_p[start:end],dtype=np.uint8)
+        run = np.flatnonzero(np.diff(p))+1
+        for a,b in zip(np.concatenate(([0],run)),np.concatenate((run,[len(p)]))):
+            print("  %5d +%-5d %s" % (a,b-a,", ".join(t for f,t in PERIOD_NAMES if p[a] & f)))
+        for i,l in d.island[(d.island[:,0] >= start) & (d.island[:,0] < end)]:
+            print("  data island at %d (%d packets)" % (i-start,l//spec.hdmi.PACKET_LEN))
@@ -0,0 +1,67 @@
+################################################################################
+## tmds_raw.py                                                                ##
+## Raw TMDS capture file format for the tmds_cap client.                      ##
+################################################################################
+## (C) Copyright 2023 Adam Barnes <ambarnes@gmail.com>                        ##
+## This file is part of The Tyto Project. The Tyto Project is free software:  ##
+## you can redistribute it and/or modify it under the terms of the GNU Lesser ##
+## General Public License as published by the Free Software Foundation,       ##
+## either version 3 of the License, or (at your option) any later version.    ##
+## The Tyto Project is distributed in the hope that it will be useful, but    ##
+## WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY ##
+## or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public     ##
+## License for more details. You should have received a copy of the GNU       ##
+## Lesser General Public License along with The Tyto Project. If not, see     ##
+## https://www.gnu.org/licenses/.                                             ##
+################################################################################
+# A raw capture file is a fixed header (HEADER, padded to PAGE bytes), then
+# the capture data exactly as received from the hardware: one pixel per 32
+# bit word (SPARSE), or 16 pixels per 60 bytes (DENSE). The payload starts on
+# a page boundary, so that it can be mapped into memory and used in place.
+# Files without a header (as written by earlier versions) are read as sparse
+# pixels.
+
+# standard modules
+import os,struct,mmap,collections
+
+MAGIC   = b'TMDSCAP\0'
+VERSION = 1
+PAGE    = 4096 # payload offset
+
+# packing
+SPARSE = 0 # one pixel (3 x 10 bits) per 32 bit word
+DENSE  = 1 # 16 pixels in 60 bytes, LSB first
+
+# magic, version, payload offset, pixels, packing, FREQ, ASTAT, capture time (us since epoch), payload bytes
+HEADER = struct.Struct('<8sLLLLLLQQ')
+
+Header = collections.namedtuple('Header','version offset pixels packing freq astat time_us nb')
+
+# write a capture: the payload (any buffer) is written as is, without a copy
+def write(path,payload,pixels,packing,freq=0,astat=0,time_us=0):
+    b = memoryview(payload).cast('B')
+    h = HEADER.pack(MAGIC,VERSION,PAGE,pixels,packing,freq,astat,time_us,len(b))
+    with open(path,'wb',buffering=0) as f:
+        f.write(h+bytes(PAGE-len(h)))
+        i = 0
+        while i < len(b):
+            i += f.write(b[i:])
+
+# read a capture: return its Header and its payload (a read only memoryview
+# of the mapped file)
+def read(path):
+    with open(path,'rb') as f:
+        nb = os.fstat(f.fileno()).st_size
+        m = mmap.mmap(f.fileno(),0,access=mmap.ACCESS_READ) if nb else b''
+    if nb >= HEADER.size and m[:len(MAGIC)] == MAGIC:
+        _,version,offset,pixels,packing,freq,astat,time_us,pb = HEADER.unpack_from(m)
+        if version != VERSION:
+            raise ValueError("unsupported raw capture file version (%d)" % version)
+        if offset+pb > nb:
+            raise ValueError("raw capture file is truncated (expected %d bytes, found %d)" % (offset+pb,nb))
+        h = Header(version,offset,pixels,packing,freq,astat,time_us,pb)
+    else: # no header
+        if nb % 4:
+            raise ValueError("size of headerless raw capture file is not a multiple of 4")
+        h = Header(0,0,nb//4,SPARSE,0,0,0,nb)
+    return h,memoryview(m)[h.offset:h.offset+h.nb]
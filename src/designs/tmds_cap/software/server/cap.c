@@ -4,22 +4,29 @@
 #include <stdio.h>
 
 #include "sleep.h"
+#include "xil_cache.h"
 
 #include "csr.h"
 #include "dma.h"
 #include "sdram.h"
+#include "global.h"
 
 #include "cap.h"
 
-#define CAP_BUF_ALIGN_PIXELS 4
-#define CAP_BUF_ALIGN_BYTES (4*CAP_BUF_ALIGN_PIXELS)
-volatile uint32_t cap_buf_unaligned[CAP_BUF_PIXELS+CAP_BUF_ALIGN_PIXELS];
+#define CAP_BUF_ALIGN_WORDS 8 // cache line
+#define CAP_BUF_ALIGN_BYTES (4*CAP_BUF_ALIGN_WORDS)
+volatile uint32_t cap_buf_unaligned[CAP_BUF_WORDS+CAP_BUF_ALIGN_WORDS];
 
 // hack to disable test pattern generation
 #define CSR_CAPCTRL_TEST 0
 
 void cap_init() {
     cap_buf = (uint32_t *)((CAP_BUF_ALIGN_BYTES+(uint32_t)cap_buf_unaligned) & -CAP_BUF_ALIGN_BYTES);
+#ifndef CAP_ACP
+    // the CPU does not write the buffer after this (it was cleared at startup),
+    // so no dirty lines can later be evicted over captured data
+    Xil_DCacheFlushRange((uint32_t)cap_buf, CAP_BUF_BYTES);
+#endif
     CSR_POKE(RA_CAPCTRL, CSR_CAPCTRL_RST);
     usleep(1);
     CSR_POKE(RA_CAPCTRL, CSR_CAPCTRL_TEST);
@@ -27,29 +34,174 @@ void cap_init() {
     dma_init();
 }
 
-void cap_start(uint32_t pixels) {
-	sdram_fill((uint32_t)cap_buf, 4*pixels, 0xAAAAAAAA, 0 ); // invalid TMDS characters
-    dma_start((uint32_t)cap_buf, 4*pixels);
-    CSR_POKE(RA_CAPSIZE, pixels);
-    CSR_POKE(RA_CAPCTRL, CSR_CAPCTRL_EN | CSR_CAPCTRL_TEST);
+static int cap_sg;           // scatter gather DMA available
+static uint32_t cap_words;  // words to be captured
+static uint32_t cap_armed;  // words for which DMA transfers have been started
+static uint32_t cap_done;   // words for which DMA transfers have completed
+static uint32_t cap_freed;  // words released by the consumer
+static uint32_t cap_cwords; // words per chunk
+static uint32_t cap_chunk;  // size of DMA transfer in progress (words), 0 = none (simple mode)
+static uint32_t cap_mode;   // CAPCTRL bits that persist after the capture is enabled
+static volatile uint32_t cap_stat; // CAPSTAT as sampled by interrupt
+static int cap_dma_err;     // DMA transfer failed or was short (capture abandoned)
+
+// start DMA transfers for next chunks, as long as there is room for them in the ring
+static void cap_arm() {
+    uint32_t n;
+
+    do {
+        n = cap_words - cap_armed;
+        if (n > cap_cwords)
+            n = cap_cwords;
+        if (!n || (cap_armed + n - cap_freed > CAP_BUF_WORDS))
+            return;
+        if (cap_sg) {
+            if (!dma_sg_submit((uint32_t)&cap_buf[cap_armed % CAP_BUF_WORDS], 4*n))
+                return; // descriptor ring full
+        }
+        else {
+            if (cap_chunk)
+                return; // transfer already in progress
+            dma_start((uint32_t)&cap_buf[cap_armed % CAP_BUF_WORDS], 4*n);
+            cap_chunk = n;
+        }
+        cap_armed += n;
+    } while (cap_sg);
+}
+
+// set trigger for subsequent captures (TRIGCTRL value, pre-trigger pixels, packet header value and mask)
+void cap_trigger(uint32_t ctrl, uint32_t pre, uint32_t hdr, uint32_t mask) {
+    CSR_POKE(RA_TRIGCTRL, ctrl);
+    CSR_POKE(RA_TRIGPRE, pre);
+    CSR_POKE(RA_TRIGHDR, hdr);
+    CSR_POKE(RA_TRIGMASK, mask);
+}
+
+// set window for subsequent captures (WINCTRL value, lines, pixels (count:first) and frames to skip)
+void cap_window(uint32_t ctrl, uint32_t line, uint32_t pix, uint32_t skip) {
+    CSR_POKE(RA_WINCTRL, ctrl);
+    CSR_POKE(RA_WINLINE, line);
+    CSR_POKE(RA_WINPIX, pix);
+    CSR_POKE(RA_WINSKIP, skip);
+}
+
+// start capture of n pixels (or packets), return number of buffer words it will produce
+// Dense captures are rounded up to a multiple of 32 pixels (15 x 64 bits).
+uint32_t cap_start(uint32_t n, int mode) {
+    uint32_t chunk = (mode == CAP_PKT) ? CAP_CHUNK_PKTS : CAP_CHUNK_PIXELS;
+
+    if (mode == CAP_DENSE)
+        n = (n+31) & ~31;
+    cap_words = CAP_WORDS(n, mode);
+    cap_cwords = CAP_WORDS(chunk, mode);
+    cap_armed = cap_done = cap_freed = cap_chunk = 0;
+    cap_stat = 0;
+    cap_dma_err = 0;
+    cap_event = 0;
+    CSR_POKE(RA_CAPCTRL, CSR_CAPCTRL_RST); // abandon any capture still waiting for a trigger
+    usleep(1);
+    CSR_POKE(RA_CAPCTRL, CSR_CAPCTRL_TEST);
+#ifdef CAP_FILL
+    // debug: make words that are never captured obvious (invalid TMDS characters)
+    sdram_fill((uint32_t)cap_buf, 4*(cap_words < CAP_BUF_WORDS ? cap_words : CAP_BUF_WORDS), 0xAAAAAAAA, 0 );
+#ifndef CAP_ACP
+    Xil_DCacheFlushRange((uint32_t)cap_buf, 4*(cap_words < CAP_BUF_WORDS ? cap_words : CAP_BUF_WORDS));
+#endif
+#endif
+    CSR_POKE(RA_CAPSIZE, n);
+    CSR_POKE(RA_CAPCHUNK, chunk);
+    dma_reset(); // abandon any tail left over from the previous capture
+    dma_init();
+    cap_sg = dma_sg_included();
+    if (cap_sg)
+        dma_sg_init();
+    cap_arm();
+    cap_mode = (mode == CAP_DENSE ? CSR_CAPCTRL_DENSE : mode == CAP_PKT ? CSR_CAPCTRL_PKT : 0) | CSR_CAPCTRL_TEST;
+    CSR_POKE(RA_CAPCTRL, CSR_CAPCTRL_EN | CSR_CAPCTRL_IE | cap_mode);
+    return cap_words;
+}
+
+// abandon capture
+void cap_stop() {
+    CSR_POKE(RA_CAPCTRL, CSR_CAPCTRL_RST);
+    usleep(1);
+    CSR_POKE(RA_CAPCTRL, CSR_CAPCTRL_TEST);
+    dma_reset();
+    dma_init();
+    cap_words = cap_armed = cap_done = cap_chunk = 0;
+}
+
+// chunk written by DMA: discard any cached copy of its previous contents
+// (lines may have been read, or speculatively fetched, since it was armed)
+static void cap_complete(uint32_t words) {
+#ifndef CAP_ACP
+    Xil_DCacheInvalidateRange((uint32_t)&cap_buf[cap_done % CAP_BUF_WORDS], 4*words);
+#endif
+    cap_done += words;
+}
+
+// retire completed DMA transfers
+static void cap_reap() {
+    uint32_t bytes, n;
+    int r;
+
+    if (cap_sg) {
+        while (!cap_dma_err && (r = dma_sg_reap(&bytes))) {
+            // every chunk but the last is whole (ended by tlast)
+            n = (cap_words - cap_done < cap_cwords) ? cap_words - cap_done : cap_cwords;
+            if (r < 0 || bytes != 4*n) {
+                printf("DMA error: DMASR = %08lX, %lu of %lu bytes\r\n",
+                    (unsigned long)dma_status(), (unsigned long)bytes, 4UL*n);
+                cap_dma_err = 1; // words after this are not where they should be
+                break;
+            }
+            cap_complete(n);
+        }
+    }
+    else if (cap_chunk && dma_idle()) {
+        cap_complete(cap_chunk);
+        cap_chunk = 0;
+    }
 }
 
-uint32_t cap_rdy() {
-    if (
-        (CSR_PEEK(RA_CAPCTRL) & CSR_CAPCTRL_EN) &&
-        (CSR_PEEK(RA_CAPSTAT) & CSR_CAPSTAT_STOP) &&
-        dma_idle()
-    ) {
-        CSR_POKE(RA_CAPCTRL, CSR_CAPCTRL_TEST);
-        return CSR_PEEK(RA_CAPSIZE);
+// service DMA, return number of words captured so far
+// Peripheral registers are only read after an interrupt has signalled an event.
+uint32_t cap_poll() {
+    if (!cap_event || cap_done == cap_words)
+        return cap_done;
+    cap_event = 0;
+    cap_reap();
+    if (cap_done == cap_words) {
+        CSR_POKE(RA_CAPCTRL, cap_mode);
+        return cap_done;
     }
-    else
-        return 0;
+    if (cap_armed < cap_words)
+        cap_arm(); // next chunk, if ring had space
+    return cap_done;
+}
+
+// capture interrupt (stop or overflow): sample status, then clear enables to acknowledge
+void cap_irq_ack() {
+    cap_stat = CSR_PEEK(RA_CAPSTAT);
+    CSR_POKE(RA_CAPCTRL, cap_mode);
+}
+
+// consumer has finished with words below specified count
+void cap_release(uint32_t words) {
+    cap_freed = words;
+    if (cap_armed < cap_words)
+        cap_arm(); // ring space may now be available
+}
+
+// FIFO overflow: DMA could not keep up, or ring was full for too long
+// Also true after a failed or short DMA transfer: the capture cannot complete.
+int cap_overrun() {
+    return (cap_stat & CSR_CAPSTAT_OVF) || cap_dma_err;
 }
 
 void cap_reg_dump()
 {
-    uint32_t r;
+    unsigned long r; // for the %l formats below
 
     printf("\r\n");
     r = CSR_PEEK( RA_SIGNATURE );
@@ -89,6 +241,7 @@ void cap_reg_dump()
     r = CSR_PEEK( RA_CAPSIZE   ); printf("  CAPSIZE   : %08lX\r\n", r);
     r = CSR_PEEK( RA_CAPSTAT   ); printf("  CAPSTAT   : %08lX\r\n", r);
     r = CSR_PEEK( RA_CAPCOUNT  ); printf("  CAPCOUNT  : %08lX\r\n", r);
+    r = CSR_PEEK( RA_CAPCHUNK  ); printf("  CAPCHUNK  : %08lX\r\n", r);
     r = CSR_PEEK( RA_SCRATCH   ); printf("  SCRATCH   : %08lX\r\n", r);
     printf("\r\n");
 }
@@ -5,13 +5,48 @@
 
 #include <stdint.h>
 
-#define CAP_BUF_PIXELS (16*1024*1024)
-#define CAP_BUF_BYTES (4*CAP_BUF_PIXELS)
+// The capture buffer holds 32 bit words: one pixel each (sparse), 16 pixels
+// per 15 words (dense, 30 bits per pixel), or CAP_PKT_WORDS per data island
+// packet (packet captures: see tmds_cap_pkt.vhd). It is filled in chunks, and
+// used as a ring if a capture is larger than it. Its size is a whole number of
+// chunks in any mode.
+// Cache: the buffer is flushed once at initialisation, and each chunk is
+// invalidated as its DMA transfer completes, so words below cap_poll() may be
+// read through the cache. Define CAP_ACP if DMA writes through the ACP port
+// (coherent with the CPU caches): no maintenance is then needed.
+#define CAP_BUF_WORDS (15*1024*1024)
+#define CAP_BUF_BYTES (4*CAP_BUF_WORDS)
+#define CAP_CHUNK_PIXELS (256*1024)
+#define CAP_CHUNK_PKTS 256
+
+// the capture hardware needs even (sparse) and whole 32 pixel (dense) chunks
+#if CAP_CHUNK_PIXELS % 32
+#error CAP_CHUNK_PIXELS must be a multiple of 32
+#endif
+
+// capture modes
+#define CAP_SPARSE 0
+#define CAP_DENSE  1
+#define CAP_PKT    2
+
+#define CAP_PKT_WORDS 10 // 8 byte timestamp, 32 byte packet
+
+#define CAP_MAX_PIXELS 0xFFFFFFE0 // dense captures are rounded up to 32 pixels
+
+// buffer words needed to hold a number of pixels (or packets)
+#define CAP_WORDS(n,mode) \
+    ((mode) == CAP_DENSE ? 15*(((n)+15)/16) : (mode) == CAP_PKT ? CAP_PKT_WORDS*(n) : (n))
 
 extern volatile uint32_t *cap_buf;
 void cap_init();
-void cap_start(uint32_t pixels);
-uint32_t cap_rdy();
+void cap_trigger(uint32_t ctrl, uint32_t pre, uint32_t hdr, uint32_t mask);
+void cap_window(uint32_t ctrl, uint32_t line, uint32_t pix, uint32_t skip);
+uint32_t cap_start(uint32_t n, int mode);
+void cap_stop();
+uint32_t cap_poll();
+void cap_release(uint32_t words);
+int cap_overrun();
+void cap_irq_ack();
 void cap_reg_dump();
 
 #endif
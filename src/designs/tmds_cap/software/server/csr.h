@@ -10,12 +10,36 @@
 
 #define CSR_BASEADDR XPAR_MAXI32_BASEADDR
 
-#define CSR_CAPCTRL_EN   1<<0
-#define CSR_CAPCTRL_TEST 1<<1
-#define CSR_CAPCTRL_RST  1<<31
+#define CSR_CAPCTRL_EN    1<<0
+#define CSR_CAPCTRL_TEST  1<<1
+#define CSR_CAPCTRL_IE    1<<2
+#define CSR_CAPCTRL_DENSE 1<<3
+#define CSR_CAPCTRL_PKT   1<<4
+#define CSR_CAPCTRL_RST   1<<31
 
 #define CSR_CAPSTAT_RUN  1<<0
 #define CSR_CAPSTAT_STOP 1<<1
+#define CSR_CAPSTAT_ARM  1<<2
+#define CSR_CAPSTAT_LOSS 1<<4
+#define CSR_CAPSTAT_OVF  1<<5
+#define CSR_CAPSTAT_UNF  1<<6
+
+#define CSR_TRIGCTRL_NONE   0
+#define CSR_TRIGCTRL_VS     1     // VSYNC edge
+#define CSR_TRIGCTRL_DI     2     // data island preamble
+#define CSR_TRIGCTRL_PH     3     // packet header match
+#define CSR_TRIGCTRL_MODE   3
+#define CSR_TRIGCTRL_VSFALL 1<<4  // VSYNC falling edge
+
+#define CSR_WINCTRL_EN      1<<0
+#define CSR_WINCTRL_HPOL    1<<4  // HSYNC active low
+#define CSR_WINCTRL_VPOL    1<<5  // VSYNC active low
+
+#define CSR_VTMSTAT_HVALID    1<<0
+#define CSR_VTMSTAT_VVALID    1<<1
+#define CSR_VTMSTAT_INTERLACE 1<<2
+#define CSR_VTMSTAT_HPOL      1<<4  // HSYNC active high
+#define CSR_VTMSTAT_VPOL      1<<5  // VSYNC active high
 
 #define CSR_POKE(a,d) *(volatile uint32_t *)(CSR_BASEADDR+a)=d
 #define CSR_PEEK(a)   *(volatile uint32_t *)(CSR_BASEADDR+a)
@@ -6,17 +6,48 @@
 #include "xparameters.h"
 #include "xil_cache.h"
 
+#include "dma.h"
+
 #define DMA_BASEADDR XPAR_AXI_DMA_BASEADDR
 
 #define S2MM_DMACR        0x30 // control register
 #define S2MM_DMASR        0x34 // status register
+#define S2MM_CURDESC      0x38 // current descriptor pointer bits 31..0
+#define S2MM_CURDESC_MSB  0x3C // current descriptor pointer bits 63..32
+#define S2MM_TAILDESC     0x40 // tail descriptor pointer bits 31..0
+#define S2MM_TAILDESC_MSB 0x44 // tail descriptor pointer bits 63..32
 #define S2MM_DMADA        0x48 // destination address bits 31..0
 #define S2MM_DMADA_MSB    0x4C // destination address bits 63..32
 #define S2MM_LENGTH       0x58 // length (bytes)
 #define S2MM_DMACR_RS     1<<0
 #define S2MM_DMACR_RESET  1<<2
+#define S2MM_DMACR_IOC_IRQEN 1<<12
+#define S2MM_DMACR_ERR_IRQEN 1<<14
 #define S2MM_DMASR_HALTED 1<<0
 #define S2MM_DMASR_IDLE   1<<1
+#define S2MM_DMASR_SGINCLD 1<<3
+#define S2MM_DMASR_IOC_IRQ 1<<12
+#define S2MM_DMASR_ERR_IRQ 1<<14
+
+// run, with interrupts on completion and error
+#define S2MM_DMACR_RUN (S2MM_DMACR_RS | S2MM_DMACR_IOC_IRQEN | S2MM_DMACR_ERR_IRQEN)
+
+// scatter gather descriptor
+typedef struct {
+    uint32_t nxtdesc;
+    uint32_t nxtdesc_msb;
+    uint32_t buffer_address;
+    uint32_t buffer_address_msb;
+    uint32_t reserved[2];
+    uint32_t control;
+    uint32_t status;
+    uint32_t app[5];
+    uint32_t pad[3]; // descriptors must be 16 word aligned
+} dma_sg_desc_t;
+
+#define DMA_SG_DESC_STATUS_CMPLT  1<<31
+#define DMA_SG_DESC_STATUS_ERR    (7<<28) // DMADecErr, DMASlvErr, DMAIntErr
+#define DMA_SG_DESC_LENGTH_MASK   0x03FFFFFF
 
 #define PEEK(a)   *(volatile uint32_t *)(DMA_BASEADDR+a)
 #define POKE(a,d) *(volatile uint32_t *)(DMA_BASEADDR+a)=d
@@ -31,11 +62,11 @@ void dma_init() {
     POKE( S2MM_DMADA_MSB , 0 );
 }
 
+// buffer cache maintenance is the caller's responsibility
 void dma_start(uint32_t addr, uint32_t bytes) {
-	Xil_DCacheFlushRange(addr, bytes);
-    POKE( S2MM_DMACR  , S2MM_DMACR_RS );
-    POKE( S2MM_DMADA  , addr          );
-    POKE( S2MM_LENGTH , bytes         );
+    POKE( S2MM_DMACR  , S2MM_DMACR_RUN );
+    POKE( S2MM_DMADA  , addr           );
+    POKE( S2MM_LENGTH , bytes          );
 }
 
 void dma_stop() {
@@ -53,3 +84,79 @@ int dma_idle() {
 uint32_t dma_status() {
     return PEEK(S2MM_DMASR);
 }
+
+// acknowledge interrupt (called from ISR), return nonzero on error
+int dma_irq_ack() {
+    uint32_t r;
+
+    r = PEEK(S2MM_DMASR) & (S2MM_DMASR_IOC_IRQ | S2MM_DMASR_ERR_IRQ);
+    POKE(S2MM_DMASR, r); // write 1 to clear
+    return r & S2MM_DMASR_ERR_IRQ;
+}
+
+//------------------------------------------------------------------------------
+// scatter gather mode
+// The descriptor ring lives in cached SDRAM, so descriptors are flushed after
+// they are written and invalidated before they are read.
+
+static dma_sg_desc_t dma_sg_ring[DMA_SG_DESCS] __attribute__ ((aligned (64)));
+static int dma_sg_head; // oldest submitted descriptor
+static int dma_sg_tail; // next free descriptor
+static int dma_sg_busy; // descriptors submitted but not yet reaped
+
+// is the scatter gather engine present in the hardware?
+int dma_sg_included() {
+    return PEEK(S2MM_DMASR) & S2MM_DMASR_SGINCLD;
+}
+
+// (re)initialise descriptor ring and start DMA engine (DMA must be halted)
+void dma_sg_init() {
+    int i;
+
+    for (i = 0; i < DMA_SG_DESCS; i++) {
+        dma_sg_ring[i].nxtdesc = (uint32_t)&dma_sg_ring[(i+1) % DMA_SG_DESCS];
+        dma_sg_ring[i].nxtdesc_msb = 0;
+        dma_sg_ring[i].buffer_address_msb = 0;
+        dma_sg_ring[i].control = 0;
+        dma_sg_ring[i].status = 0;
+    }
+    Xil_DCacheFlushRange((uint32_t)dma_sg_ring, sizeof(dma_sg_ring));
+    dma_sg_head = dma_sg_tail = dma_sg_busy = 0;
+    POKE( S2MM_CURDESC_MSB  , 0                         );
+    POKE( S2MM_CURDESC      , (uint32_t)&dma_sg_ring[0] );
+    POKE( S2MM_TAILDESC_MSB , 0                         );
+    POKE( S2MM_DMACR        , S2MM_DMACR_RUN            );
+}
+
+// queue a buffer (cache maintenance is the caller's responsibility), return 0 if descriptor ring is full
+int dma_sg_submit(uint32_t addr, uint32_t bytes) {
+    dma_sg_desc_t *d;
+
+    if (dma_sg_busy == DMA_SG_DESCS)
+        return 0;
+    d = &dma_sg_ring[dma_sg_tail];
+    d->buffer_address = addr;
+    d->control = bytes & DMA_SG_DESC_LENGTH_MASK;
+    d->status = 0;
+    Xil_DCacheFlushRange((uint32_t)d, sizeof(dma_sg_desc_t));
+    POKE(S2MM_TAILDESC, (uint32_t)d); // engine runs on to here
+    dma_sg_tail = (dma_sg_tail+1) % DMA_SG_DESCS;
+    dma_sg_busy++;
+    return 1;
+}
+
+// retire oldest buffer if complete: return 1 (OK), -1 (error) or 0 (not complete)
+int dma_sg_reap(uint32_t *bytes) {
+    dma_sg_desc_t *d;
+
+    if (!dma_sg_busy)
+        return 0;
+    d = &dma_sg_ring[dma_sg_head];
+    Xil_DCacheInvalidateRange((uint32_t)d, sizeof(dma_sg_desc_t));
+    if (!(d->status & DMA_SG_DESC_STATUS_CMPLT))
+        return 0;
+    *bytes = d->status & DMA_SG_DESC_LENGTH_MASK;
+    dma_sg_head = (dma_sg_head+1) % DMA_SG_DESCS;
+    dma_sg_busy--;
+    return (d->status & DMA_SG_DESC_STATUS_ERR) ? -1 : 1;
+}
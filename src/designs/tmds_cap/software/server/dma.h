@@ -10,5 +10,13 @@ void dma_stop();
 int dma_halted();
 int dma_idle();
 uint32_t dma_status();
+int dma_irq_ack();
+
+#define DMA_SG_DESCS 64 // scatter gather descriptor ring size
+
+int dma_sg_included();
+void dma_sg_init();
+int dma_sg_submit(uint32_t addr, uint32_t bytes);
+int dma_sg_reap(uint32_t *bytes);
 
 #endif
@@ -6,4 +6,5 @@
 
 volatile uint32_t *cap_buf;
 volatile int countdown;
+volatile int cap_event; // set by capture and DMA interrupts
 struct netif Eth0;
@@ -9,6 +9,7 @@
 
 extern volatile uint32_t *cap_buf;
 extern volatile int countdown;
+extern volatile int cap_event;
 extern struct netif Eth0;
 
 #endif
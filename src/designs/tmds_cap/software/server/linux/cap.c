@@ -0,0 +1,129 @@
+// cap.c
+// Linux host build: capture from the simulated source (see sim.c) straight
+// into the ring, a chunk at a time, at the rate the source produces data.
+// There is no DMA engine to drive, and no FIFO to overflow: if the ring is
+// full, capture waits for the consumer.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "csr.h"
+#include "global.h"
+#include "sim.h"
+
+#include "cap.h"
+
+static uint32_t cap_n;      // pixels (or packets) to be captured
+static uint32_t cap_words;  // words to be captured
+static uint32_t cap_done;   // words captured
+static uint32_t cap_freed;  // words released by the consumer
+static uint32_t cap_cwords; // words per chunk
+static int cap_mode;        // CAP_xxx
+static uint64_t cap_t0;     // time capture started (us)
+
+void cap_init() {
+    cap_buf = aligned_alloc(64, CAP_BUF_BYTES);
+    if (!cap_buf) {
+        printf("failed to allocate capture buffer\r\n");
+        exit(1);
+    }
+    CSR_POKE(RA_CAPCTRL, 0);
+}
+
+// trigger and window are recorded, but the simulated source ignores them
+void cap_trigger(uint32_t ctrl, uint32_t pre, uint32_t hdr, uint32_t mask) {
+    CSR_POKE(RA_TRIGCTRL, ctrl);
+    CSR_POKE(RA_TRIGPRE, pre);
+    CSR_POKE(RA_TRIGHDR, hdr);
+    CSR_POKE(RA_TRIGMASK, mask);
+}
+
+void cap_window(uint32_t ctrl, uint32_t line, uint32_t pix, uint32_t skip) {
+    CSR_POKE(RA_WINCTRL, ctrl);
+    CSR_POKE(RA_WINLINE, line);
+    CSR_POKE(RA_WINPIX, pix);
+    CSR_POKE(RA_WINSKIP, skip);
+}
+
+uint32_t cap_start(uint32_t n, int mode) {
+    uint32_t chunk = (mode == CAP_PKT) ? CAP_CHUNK_PKTS : CAP_CHUNK_PIXELS;
+
+    if (mode == CAP_DENSE)
+        n = (n+31) & ~31;
+    cap_n = n;
+    cap_mode = mode;
+    cap_words = CAP_WORDS(n, mode);
+    cap_cwords = CAP_WORDS(chunk, mode);
+    cap_done = cap_freed = 0;
+    cap_t0 = sim_time_us();
+    CSR_POKE(RA_CAPSIZE, n);
+    CSR_POKE(RA_CAPCHUNK, chunk);
+    CSR_POKE(RA_CAPCOUNT, 0);
+    CSR_POKE(RA_CAPSTAT, CSR_CAPSTAT_RUN);
+    CSR_POKE(RA_CAPCTRL, CSR_CAPCTRL_EN | CSR_CAPCTRL_IE |
+        (mode == CAP_DENSE ? CSR_CAPCTRL_DENSE : mode == CAP_PKT ? CSR_CAPCTRL_PKT : 0));
+    return cap_words;
+}
+
+void cap_stop() {
+    CSR_POKE(RA_CAPCTRL, 0);
+    CSR_POKE(RA_CAPSTAT, CSR_CAPSTAT_STOP);
+    cap_words = cap_done = 0;
+}
+
+// capture whole chunks as the source produces them, return number of words captured so far
+uint32_t cap_poll() {
+    uint64_t p;
+    uint32_t n, i, k;
+
+    if (cap_done == cap_words)
+        return cap_done;
+    p = sim_pixels(sim_time_us()-cap_t0); // produced by source
+    if (cap_mode == CAP_PKT)
+        p = p * SIM_PKTS_PER_FRAME / SIM_FRAME_PIXELS;
+    if (p > cap_n)
+        p = cap_n;
+    n = CAP_WORDS(p, cap_mode);
+    if (n > cap_words)
+        n = cap_words; // dense: last group
+    if (n < cap_words)
+        n -= n % cap_cwords;
+    if (n > cap_freed + CAP_BUF_WORDS)
+        n = cap_freed + CAP_BUF_WORDS; // wait for ring space
+    while (cap_done < n) {
+        i = cap_done % CAP_BUF_WORDS;
+        k = n - cap_done;
+        if (k > CAP_BUF_WORDS-i)
+            k = CAP_BUF_WORDS-i;
+        sim_fill((uint32_t *)&cap_buf[i], cap_done, k, cap_mode);
+        cap_done += k;
+    }
+    CSR_POKE(RA_CAPCOUNT, p);
+    if (cap_done == cap_words) {
+        CSR_POKE(RA_CAPSTAT, CSR_CAPSTAT_STOP);
+        CSR_POKE(RA_CAPCTRL, CSR_PEEK(RA_CAPCTRL) & ~(CSR_CAPCTRL_EN | CSR_CAPCTRL_IE));
+    }
+    return cap_done;
+}
+
+void cap_release(uint32_t words) {
+    cap_freed = words;
+}
+
+int cap_overrun() {
+    return 0;
+}
+
+void cap_irq_ack() {
+}
+
+void cap_reg_dump()
+{
+    int i;
+
+    printf("\r\n");
+    for (i = 0; i < 64; i++)
+        printf("  %03X : %08X\r\n", 4*i, (unsigned int)CSR_PEEK(4*i));
+    printf("\r\n");
+}
@@ -0,0 +1,80 @@
+// hal.c
+// Linux host HAL: lwIP runs over a TAP device (lwIP unix port), and the
+// capture hardware is simulated (see sim.c).
+// Environment:
+//  TMDS_CAP_IP         static IPv4 address (/24, gateway .1), else DHCP
+//  PRECONFIGURED_TAPIF existing TAP device to use (see lwIP tapif.c), else
+//                      tap0 is created and given the gateway address
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hal.h"
+
+#include "lwip/ip4_addr.h"
+#include "netif/ethernet.h"
+#include "netif/tapif.h"
+
+#include "global.h"
+#include "sim.h"
+
+static u32_t tick; // time of last countdown tick (ms)
+
+void hal_init(void)
+{
+    printf("Linux host build: simulated capture hardware\r\n");
+    sim_init();
+    tick = sys_now();
+}
+
+void hal_enable_interrupts(void)
+{
+    // nothing to do: hal_netif_rx() does the work of the timer interrupt
+}
+
+struct netif * hal_netif_add(
+    struct netif *netif,
+    ip_addr_t *ipaddr,
+    ip_addr_t *netmask,
+    ip_addr_t *gateway
+)
+{
+    const char *s = getenv("TMDS_CAP_IP");
+    ip4_addr_t a, m, g; // copies: the arguments may point into netif
+
+    ip4_addr_copy(a, *ipaddr);
+    ip4_addr_copy(m, *netmask);
+    ip4_addr_copy(g, *gateway);
+    if (s && ip4addr_aton(s, &a)) {
+        IP4_ADDR(&m, 255, 255, 255, 0);
+        IP4_ADDR(&g, ip4_addr1(&a), ip4_addr2(&a), ip4_addr3(&a), 1);
+    }
+    return netif_add(
+        netif,
+        &a,
+        &m,
+        &g,
+        NULL,
+        tapif_init,
+        ethernet_input
+    );
+}
+
+// called from the foreground loop: poll the TAP device, stand in for the
+// timer interrupt, and advance the simulated hardware
+void hal_netif_rx(struct netif *netif)
+{
+    u32_t now = sys_now();
+
+    tapif_poll(netif);
+    while (now - tick >= SCUTIMER_INTERVAL_MSECS) {
+        tick += SCUTIMER_INTERVAL_MSECS;
+        countdown--;
+    }
+    sim_run();
+}
+
+void print(const char *s)
+{
+    fputs(s, stdout);
+}
@@ -0,0 +1,18 @@
+// hal.h
+
+#ifndef _HAL_H_
+#define _HAL_H_
+
+#include "lwip/tcp.h"
+
+#define SCUTIMER_INTERVAL_MSECS 100
+#define COUNTDOWN_SEC           (1000/SCUTIMER_INTERVAL_MSECS)
+
+void hal_init(void);
+void hal_enable_interrupts(void);
+struct netif * hal_netif_add(struct netif *netif, ip_addr_t *ipaddr, ip_addr_t *netmask, ip_addr_t *gateway);
+void hal_netif_rx(struct netif *netif);
+
+void print(const char *s); // xil_printf.h
+
+#endif
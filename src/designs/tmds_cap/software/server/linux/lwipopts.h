@@ -0,0 +1,39 @@
+// lwipopts.h
+// Linux host build: lwIP options. Sizes follow the lwip213 BSP defaults,
+// with the design's BSP settings (see tmds_cap.mak), so that transfers
+// behave as they do on the target.
+
+#ifndef _LWIPOPTS_H_
+#define _LWIPOPTS_H_
+
+#define NO_SYS                  1
+#define LWIP_TIMERS             1
+#define LWIP_NETCONN            0
+#define LWIP_SOCKET             0
+#define SYS_LIGHTWEIGHT_PROT    0
+
+#define LWIP_IPV4               1
+#define LWIP_IPV6               0
+#define LWIP_DHCP               1
+#define LWIP_UDP                1
+#define LWIP_TCP                1
+
+#define MEM_ALIGNMENT           8
+#define MEM_SIZE                131072
+#define MEMP_NUM_PBUF           256
+#define MEMP_NUM_UDP_PCB        4
+#define MEMP_NUM_TCP_PCB        32
+#define MEMP_NUM_TCP_PCB_LISTEN 8
+#define MEMP_NUM_TCP_SEG        256
+#define PBUF_POOL_SIZE          256
+#define PBUF_POOL_BUFSIZE       1700
+
+#define TCP_MSS                 1460
+#define TCP_SND_BUF             8192
+#define TCP_WND                 2048
+#define TCP_SND_QUEUELEN        (16 * TCP_SND_BUF/TCP_MSS)
+#define TCP_QUEUE_OOSEQ         1
+
+#define LWIP_STATS              0
+
+#endif
@@ -0,0 +1,245 @@
+// sim.c
+// Simulated tmds_cap hardware (Linux host build).
+// The TMDS source is one frame of 640x480p60 (DVI timing with HDMI video
+// preambles and guard bands, no data islands) showing colour bars, encoded
+// once and repeated. Pixel 0 is the first active pixel of the frame.
+// Registers that describe the source (FREQ, ASTAT, VTMxxx) are set once;
+// video signatures (CRCxxx) are made at the frame rate by sim_run().
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "csr.h"
+#include "cap.h"
+#include "sim.h"
+
+#define H_ACTIVE 640
+#define H_FP     16
+#define H_SYNC   96
+#define V_ACTIVE 480
+#define V_FP     10
+#define V_SYNC   2
+
+#define VS_START    ((V_ACTIVE+V_FP-1)*SIM_H_TOTAL+H_ACTIVE+H_FP) // VSYNC leading edge (with HSYNC)
+#define VS_END      (VS_START+V_SYNC*SIM_H_TOTAL)
+#define DENSE_WORDS (15*SIM_FRAME_PIXELS/16)
+
+volatile uint32_t sim_csr[SIM_CSR_WORDS];
+
+static uint32_t frame[SIM_FRAME_PIXELS];   // sparse: one pixel per word
+static uint32_t frame_dense[DENSE_WORDS];  // dense: 16 pixels per 15 words
+static uint32_t pkt[SIM_PKTS_PER_FRAME][CAP_PKT_WORDS]; // packet records (timestamp 0)
+static uint32_t crc;                       // video signature of frame
+static uint64_t t0;                        // time of sim_init()
+
+static const uint16_t ctrl[4] = { 0x354, 0x0AB, 0x154, 0x2AB }; // control characters (C1:C0)
+static const uint16_t video_gb[3] = { 0x2CC, 0x133, 0x2CC };     // video guard band characters
+
+static const uint32_t bars[8] = { // RGB
+    0xC0C0C0, 0xC0C000, 0x00C0C0, 0x00C000, 0xC000C0, 0xC00000, 0x0000C0, 0x000000
+};
+
+uint64_t sim_time_us()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec*1000000 + t.tv_nsec/1000;
+}
+
+// pixels sent by the source in a given time
+uint64_t sim_pixels(uint64_t us)
+{
+    return us * SIM_FREQ / 100;
+}
+
+// TMDS video (8b/10b) encode, cnt = running disparity
+static uint16_t tmds_encode(uint8_t d, int *cnt)
+{
+    int n1d = __builtin_popcount(d), n1, n0, i;
+    uint16_t qm = d & 1, q;
+
+    for (i = 1; i < 8; i++)
+        if (n1d > 4 || (n1d == 4 && !(d & 1)))
+            qm |= (~((qm >> (i-1)) ^ (d >> i)) & 1) << i; // XNOR
+        else
+            qm |= (((qm >> (i-1)) ^ (d >> i)) & 1) << i; // XOR
+    if (!(n1d > 4 || (n1d == 4 && !(d & 1))))
+        qm |= 1 << 8;
+    n1 = __builtin_popcount(qm & 0xFF);
+    n0 = 8-n1;
+    if (*cnt == 0 || n1 == n0) {
+        if (qm & 0x100) {
+            q = 0x100 | (qm & 0xFF);
+            *cnt += n1-n0;
+        }
+        else {
+            q = 0x200 | (~qm & 0xFF);
+            *cnt += n0-n1;
+        }
+    }
+    else if ((*cnt > 0 && n1 > n0) || (*cnt < 0 && n0 > n1)) {
+        q = 0x200 | (qm & 0x100) | (~qm & 0xFF);
+        *cnt += 2*((qm >> 8) & 1) + n0-n1;
+    }
+    else {
+        q = (qm & 0x100) | (qm & 0xFF);
+        *cnt += -2*(~(qm >> 8) & 1) + n1-n0;
+    }
+    return q;
+}
+
+// CRC-32 (as used by Ethernet) of a byte
+static uint32_t crc32_byte(uint32_t c, uint8_t b)
+{
+    int i;
+
+    c ^= b;
+    for (i = 0; i < 8; i++)
+        c = (c >> 1) ^ (c & 1 ? 0xEDB88320 : 0);
+    return c;
+}
+
+// packet record: bytes are HB0..HB2, status, then PB0..PB27 (checksum at PB0 if info frame)
+static void pkt_init(uint32_t *r, uint8_t hb0, uint8_t hb1, uint8_t hb2, const uint8_t *pb, int pb_n)
+{
+    uint8_t b[32];
+    int i, sum;
+
+    memset(b, 0, sizeof(b));
+    b[0] = hb0;
+    b[1] = hb1;
+    b[2] = hb2;
+    memcpy(&b[4], pb, pb_n);
+    if (hb0 & 0x80) {
+        sum = hb0 + hb1 + hb2;
+        for (i = 1; i < pb_n; i++)
+            sum += pb[i];
+        b[4] = -sum;
+    }
+    r[0] = r[1] = 0;
+    memcpy(&r[2], b, sizeof(b));
+}
+
+static void frame_init()
+{
+    int x, y, ch, i, cnt[3] = { 0, 0, 0 };
+    int hs, vs, pre, gb;
+    uint32_t rgb, w, f;
+    uint16_t q[3];
+    uint64_t a;
+    static const uint8_t avi[14] = { 0, 0x00, 0x08, 0x00, 1 }; // RGB, 640x480p60 (VIC 1)
+    static const uint8_t aif[11] = { 0, 0x01 };                // 2 channels
+    static const uint8_t gcp[7] = { 0 };                       // no AVMUTE, 24 bits per pixel
+    static const uint8_t acr[28] = {                           // N = 6144, CTS = 25175
+        0, 0x00, 0x62, 0x57, 0x00, 0x18, 0x00, 0, 0x00, 0x62, 0x57, 0x00, 0x18, 0x00,
+        0, 0x00, 0x62, 0x57, 0x00, 0x18, 0x00, 0, 0x00, 0x62, 0x57, 0x00, 0x18, 0x00
+    };
+
+    crc = 0xFFFFFFFF;
+    for (y = 0; y < SIM_V_TOTAL; y++) {
+        for (x = 0; x < SIM_H_TOTAL; x++) {
+            if (y < V_ACTIVE && x < H_ACTIVE) {
+                rgb = bars[x / (H_ACTIVE/8)];
+                for (ch = 0; ch < 3; ch++) {
+                    q[ch] = tmds_encode((rgb >> (8*ch)) & 0xFF, &cnt[ch]); // blue, green, red
+                    crc = crc32_byte(crc, (rgb >> (8*ch)) & 0xFF);
+                }
+            }
+            else {
+                // syncs are active low
+                f = y*SIM_H_TOTAL + x;
+                hs = !(x >= H_ACTIVE+H_FP && x < H_ACTIVE+H_FP+H_SYNC);
+                vs = !(f >= VS_START && f < VS_END);
+                pre = (y < V_ACTIVE-1 || y == SIM_V_TOTAL-1) && x >= SIM_H_TOTAL-10; // next line is active
+                gb = pre && x >= SIM_H_TOTAL-2;
+                cnt[0] = cnt[1] = cnt[2] = 0;
+                q[0] = gb ? video_gb[0] : ctrl[(vs << 1) | hs];
+                q[1] = gb ? video_gb[1] : ctrl[pre ? 1 : 0];
+                q[2] = gb ? video_gb[2] : ctrl[0];
+            }
+            frame[y*SIM_H_TOTAL + x] = (q[2] << 20) | (q[1] << 10) | q[0];
+        }
+    }
+    crc = ~crc;
+
+    // dense: 30 bits per pixel, LSB first
+    a = 0;
+    i = 0;
+    w = 0;
+    for (f = 0; f < SIM_FRAME_PIXELS; f++) {
+        a |= (uint64_t)frame[f] << i;
+        i += 30;
+        while (i >= 32) {
+            frame_dense[w++] = a;
+            a >>= 32;
+            i -= 32;
+        }
+    }
+
+    pkt_init(pkt[0], 0x82, 0x02, 0x0D, avi, sizeof(avi)); // AVI info frame
+    pkt_init(pkt[1], 0x84, 0x01, 0x0A, aif, sizeof(aif)); // audio info frame
+    pkt_init(pkt[2], 0x03, 0x00, 0x00, gcp, sizeof(gcp)); // general control
+    pkt_init(pkt[3], 0x01, 0x00, 0x00, acr, sizeof(acr)); // audio clock regeneration
+}
+
+void sim_init()
+{
+    frame_init();
+    memset((void *)sim_csr, 0, sizeof(sim_csr));
+    CSR_POKE(RA_SIGNATURE, 0x53444D54);
+    CSR_POKE(RA_FREQ, SIM_FREQ);
+    CSR_POKE(RA_ASTAT, 0xF1); // locked, aligned
+    CSR_POKE(RA_VTMSTAT, CSR_VTMSTAT_HVALID | CSR_VTMSTAT_VVALID);
+    CSR_POKE(RA_VTMH0, (H_ACTIVE << 16) | SIM_H_TOTAL);
+    CSR_POKE(RA_VTMH1, (H_SYNC << 16) | H_FP);
+    CSR_POKE(RA_VTMH2, SIM_H_TOTAL-H_ACTIVE-H_FP-H_SYNC);
+    CSR_POKE(RA_VTMV0, (V_ACTIVE << 16) | SIM_V_TOTAL);
+    CSR_POKE(RA_VTMV1, (V_SYNC << 16) | V_FP);
+    CSR_POKE(RA_VTMV2, SIM_V_TOTAL-V_ACTIVE-V_FP-V_SYNC);
+    CSR_POKE(RA_VTMF, SIM_FRAME_PIXELS);
+    t0 = sim_time_us();
+}
+
+// sign frames as they go by
+void sim_run()
+{
+    uint32_t n = sim_pixels(sim_time_us()-t0) / SIM_FRAME_PIXELS;
+
+    while (CSR_PEEK(RA_CRCCOUNT) != n) {
+        CSR_POKE(RA_CRCRING + 4*(CSR_PEEK(RA_CRCCOUNT) % 16), crc);
+        CSR_POKE(RA_CRCLAST, crc);
+        CSR_POKE(RA_CRCCOUNT, CSR_PEEK(RA_CRCCOUNT)+1);
+    }
+}
+
+// fill p with capture buffer words pos..pos+words-1 (CAP_xxx mode)
+void sim_fill(uint32_t *p, uint32_t pos, uint32_t words, int mode)
+{
+    uint32_t period, i, n, k;
+    uint64_t ts;
+
+    if (mode == CAP_PKT) {
+        for (i = 0; i < words; i++, pos++) {
+            k = pos / CAP_PKT_WORDS;
+            ts = (uint64_t)(k / SIM_PKTS_PER_FRAME) * SIM_FRAME_PIXELS
+                + VS_START + 32*(k % SIM_PKTS_PER_FRAME);
+            switch (pos % CAP_PKT_WORDS) {
+                case 0: p[i] = ts; break;
+                case 1: p[i] = ts >> 32; break;
+                default: p[i] = pkt[k % SIM_PKTS_PER_FRAME][pos % CAP_PKT_WORDS];
+            }
+        }
+        return;
+    }
+    period = mode == CAP_DENSE ? DENSE_WORDS : SIM_FRAME_PIXELS;
+    while (words) {
+        i = pos % period;
+        n = words < period-i ? words : period-i;
+        memcpy(p, mode == CAP_DENSE ? &frame_dense[i] : &frame[i], 4*n);
+        p += n;
+        pos += n;
+        words -= n;
+    }
+}
@@ -0,0 +1,26 @@
+// sim.h
+// Simulated tmds_cap hardware (Linux host build): a register block in
+// memory, and a synthetic source of TMDS data (640x480p60, colour bars).
+
+#ifndef _SIM_H_
+#define _SIM_H_
+
+#include <stdint.h>
+
+#define SIM_CSR_WORDS     1024 // register space (12 bit byte address)
+
+#define SIM_H_TOTAL       800
+#define SIM_V_TOTAL       525
+#define SIM_FRAME_PIXELS  (SIM_H_TOTAL*SIM_V_TOTAL)
+#define SIM_FREQ          2518 // FREQ register value (10 kHz units)
+#define SIM_PKTS_PER_FRAME 4
+
+extern volatile uint32_t sim_csr[SIM_CSR_WORDS];
+
+void sim_init();
+void sim_run();
+uint64_t sim_time_us();
+uint64_t sim_pixels(uint64_t us);
+void sim_fill(uint32_t *p, uint32_t pos, uint32_t words, int mode);
+
+#endif
@@ -0,0 +1,9 @@
+// sleep.h
+// Linux host build: stands in for the BSP header.
+
+#ifndef _SLEEP_H_
+#define _SLEEP_H_
+
+#include <unistd.h>
+
+#endif
@@ -0,0 +1,13 @@
+// xparameters.h
+// Linux host build: stands in for the BSP header.
+
+#ifndef _XPARAMETERS_H_
+#define _XPARAMETERS_H_
+
+#include <stdint.h>
+
+#include "sim.h"
+
+#define XPAR_MAXI32_BASEADDR ((uintptr_t)sim_csr)
+
+#endif
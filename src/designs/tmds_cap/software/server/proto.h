@@ -0,0 +1,171 @@
+// proto.h
+// Binary request/response protocol. Every request and response is a frame:
+// an 8 byte header followed by a payload; all fields are little endian.
+// Requests may be pipelined: each is served in turn, and its response
+// carries the request's tag. A response may span several frames, the
+// last of which has PROTO_FLAG_LAST set.
+// Several clients may be connected at once. They share one capture buffer;
+// every capture is given a new generation number, so that a client can
+// tell whether the buffer still holds the capture it asked for.
+
+#ifndef _PROTO_H_
+#define _PROTO_H_
+
+#include <stdint.h>
+
+typedef struct {
+    uint8_t  cmd;    // command
+    uint8_t  flags;  // PROTO_FLAG_xxx (response only)
+    uint8_t  status; // PROTO_xxx (response only)
+    uint8_t  tag;    // chosen by client, echoed in response
+    uint32_t len;    // payload length (bytes)
+} proto_hdr_t;
+
+#define PROTO_HDR_BYTES     8
+#define PROTO_MAX_REQ_LEN   64 // maximum request payload length
+
+// commands
+#define PROTO_CMD_CAPTURE   0x01 // request: pixels, flags, [trigger, [window]]; response: buffer words, generation
+#define PROTO_CMD_GET       0x02 // request: pixel offset, pixel count, flags, [generation]; response: data
+#define PROTO_CMD_STATUS    0x03 // response: proto_status_t
+#define PROTO_CMD_REGS      0x04 // response: CSR contents (PROTO_REGS words)
+#define PROTO_CMD_BLAST     0x05 // request: pixel offset, pixel count, flags, UDP port, [generation]; response: datagrams
+#define PROTO_CMD_RESEND    0x06 // request: (first, count) datagram pairs; response: datagrams
+#define PROTO_CMD_TIMING    0x07 // response: proto_timing_t
+#define PROTO_CMD_CRC       0x08 // request: UDP port (0 = stop); response: signature count
+#define PROTO_CMD_TELEM     0x09 // request: UDP port (0 = stop), interval (ms); response: interval, next record
+
+// capture flags
+#define PROTO_CAP_DENSE     (1<<0) // dense (30 bit) packing
+#define PROTO_CAP_REUSE     (1<<1) // use last capture (even if in progress) if it is big enough
+#define PROTO_CAP_PKT       (1<<2) // data island packets only: counts and offsets are in packets
+
+// get flags
+#define PROTO_GET_RLE       (1<<0) // run length encoded (sparse captures only)
+
+// response flags
+#define PROTO_FLAG_LAST     (1<<0) // last frame of response
+
+// response status
+#define PROTO_OK            0x00
+#define PROTO_E_CMD         0x01 // unknown command
+#define PROTO_E_ARG         0x02 // bad payload length or argument
+#define PROTO_E_SIZE        0x03 // capture larger than buffer
+#define PROTO_E_RANGE       0x04 // range outside capture
+#define PROTO_E_BUSY        0x05 // buffer in use by other clients
+#define PROTO_E_STALE       0x06 // capture overwritten by a later one
+
+typedef struct {
+    uint32_t pixels;   // pixels requested by last capture
+    uint32_t flags;    // capture flags of last capture
+    uint32_t words;    // buffer words of last capture
+    uint32_t captured; // buffer words captured so far
+    uint32_t capstat;  // CAPSTAT register
+    uint32_t freq;     // FREQ register
+    uint32_t gen;      // generation of last capture
+} proto_status_t;
+
+#define PROTO_REGS          64 // CSR words returned by PROTO_CMD_REGS
+
+// video timing, as measured continuously by the hardware (see tmds_cap_vtm.vhd)
+typedef struct {
+    uint32_t stat;          // VTMSTAT register (CSR_VTMSTAT_xxx)
+    uint32_t h_total;       // pixels per line
+    uint32_t h_active;      // active pixels per line
+    uint32_t h_front_porch; // pixels
+    uint32_t h_sync;        // pixels
+    uint32_t h_back_porch;  // pixels
+    uint32_t v_total;       // lines per frame
+    uint32_t v_active;      // active lines (first field if interlaced)
+    uint32_t v_front_porch; // whole lines
+    uint32_t v_sync;        // lines
+    uint32_t v_back_porch;  // lines
+    uint32_t f_total;       // pixels per frame
+    uint32_t freq;          // FREQ register
+} proto_timing_t;
+
+// optional capture trigger: TRIGCTRL, TRIGPRE, TRIGHDR and TRIGMASK register
+// values (see tmds_cap_csr_ra.csv); the capture starts TRIGPRE pixels before
+// the trigger pixel, and waits until the trigger occurs
+#define PROTO_TRIG_WORDS    4
+
+// optional capture window (follows the trigger words): WINCTRL, WINLINE,
+// WINPIX and WINSKIP register values; only pixels within the window are
+// captured (and counted), so a capture may span several frames
+#define PROTO_WIN_WORDS     4
+
+// packet capture (PROTO_CAP_PKT): each packet is PROTO_PKT_BYTES: a 64 bit
+// timestamp (pixels from capture start), then HB0..HB2, a status byte
+// (PROTO_PKT_E_xxx), and bytes 0..6 of subpackets 0..3 (ECC bytes removed)
+#define PROTO_PKT_BYTES     40
+#define PROTO_PKT_E_HB      (1<<0) // header ECC error
+#define PROTO_PKT_E_SB(i)   (1<<(1+(i))) // subpacket i ECC error
+
+// UDP blast: capture data is sent as datagrams to the client's UDP port,
+// each with a header giving its sequence number. The TCP response is sent
+// once every datagram has been sent; the client then requests missing
+// datagrams with PROTO_CMD_RESEND until it has them all.
+typedef struct {
+    uint32_t seq;      // datagram number (data starts at seq * PROTO_BLAST_WORDS)
+    uint32_t gen;      // capture generation
+} proto_blast_hdr_t;
+
+#define PROTO_BLAST_HDR_BYTES 8
+#define PROTO_BLAST_WORDS     366 // data words per datagram (fills 1472 byte UDP payload)
+
+// video signatures: the hardware signs the active video of every field
+// (CRC-32 of the decoded pixels, see tmds_cap_crc.vhd). Once subscribed
+// (PROTO_CMD_CRC with a nonzero UDP port), a client is sent each new
+// signature as it is made, as datagrams of one or more proto_crc_t. Fields
+// are numbered from hardware reset; the server keeps up to PROTO_CRC_RING
+// signatures, so a gap in field numbers means signatures were lost.
+typedef struct {
+    uint32_t field;    // field number
+    uint32_t crc;      // signature
+} proto_crc_t;
+
+#define PROTO_CRC_RING      16
+
+// telemetry: the server samples alignment and capture registers every
+// interval into a ring of PROTO_TELEM_RING records. Once subscribed
+// (PROTO_CMD_TELEM with a nonzero UDP port), a client is sent each new
+// record as it is made, as datagrams of one or more proto_telem_t. The
+// interval is the shortest asked for by any subscribed client; records are
+// numbered from server start, so a gap in numbers means records were lost.
+typedef struct {
+    uint32_t seq;      // record number
+    uint32_t time;     // sample time (ms, server clock)
+    uint32_t freq;     // FREQ
+    uint32_t astat;    // ASTAT
+    uint32_t atap;     // ATAP
+    uint32_t abitslip; // ABITSLIP
+    uint32_t again[4]; // AGAIN0..2, AGAINP
+    uint32_t aloss[4]; // ALOSS0..2, ALOSSP
+    uint32_t capstat;  // CAPSTAT
+    uint32_t capcount; // CAPCOUNT
+} proto_telem_t;
+
+#define PROTO_TELEM_RING     64
+#define PROTO_TELEM_MIN_MS   1    // shortest interval
+#define PROTO_TELEM_PER_DGRAM 16  // most records per datagram
+
+// discovery: a client broadcasts PROTO_DISCO_QUERY to UDP port 65400, and
+// every server replies at once (to the client's address and port) with a
+// proto_disco_t. Servers also broadcast "tmds_cap disco" once per second,
+// for clients that do not query.
+#define PROTO_DISCO_QUERY   "tmds_cap query"
+#define PROTO_DISCO_MAGIC   "tmds_cap disco"
+#define PROTO_VERSION       0x0100 // server version: major (15:8), minor (7:0)
+
+typedef struct {
+    char     magic[16];     // PROTO_DISCO_MAGIC (NUL padded)
+    uint32_t version;       // PROTO_VERSION
+    uint32_t signature;     // SIGNATURE register
+    uint32_t buf_bytes;     // capture buffer size
+    uint32_t freq;          // FREQ register
+    uint32_t astat;         // ASTAT register (bit 0 = lock)
+    uint16_t tcp_port;      // port for requests
+    uint16_t clients;       // clients connected
+} proto_disco_t;
+
+#endif
@@ -0,0 +1,84 @@
+// rle.c
+
+#include <stdint.h>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#include "rle.h"
+
+void rle_init(rle_state_t *s) {
+    s->last = 0;
+    s->run = 0;
+    s->any = 0;
+}
+
+// count leading pixels equal to v
+static uint32_t rle_scan(const uint32_t *p, uint32_t n, uint32_t v) {
+    uint32_t i = 0;
+
+#ifdef __ARM_NEON
+    // 4 pixels at a time
+    uint32x4_t vv = vdupq_n_u32(v);
+    uint32x4_t vm = vdupq_n_u32(RLE_PIXEL_MASK);
+    uint32x4_t c;
+    uint32x2_t r;
+    for (; i+4 <= n; i += 4) {
+        c = vceqq_u32(vandq_u32(vld1q_u32(p+i), vm), vv);
+        r = vand_u32(vget_low_u32(c), vget_high_u32(c));
+        if ((vget_lane_u32(r, 0) & vget_lane_u32(r, 1)) != 0xFFFFFFFF)
+            break;
+    }
+#endif
+    while (i < n && (p[i] & RLE_PIXEL_MASK) == v)
+        i++;
+    return i;
+}
+
+// encode up to *n_in pixels into at most n_out words
+// On return, *n_in holds the number of pixels consumed. A run that is still
+// open is held in the state until a different pixel arrives, or until
+// rle_flush() is called.
+uint32_t rle_encode(rle_state_t *s, const uint32_t *in, uint32_t *n_in, uint32_t *out, uint32_t n_out) {
+    uint32_t i = 0, o = 0, p, r;
+
+    while (i < *n_in) {
+        p = in[i] & RLE_PIXEL_MASK;
+        if (s->any && p == s->last) {
+            if (s->run == RLE_MAX_RUN) { // full: emit it and start another
+                if (o + 1 > n_out)
+                    break;
+                out[o++] = RLE_REPEAT | s->run;
+                s->run = 0;
+            }
+            r = rle_scan(&in[i], *n_in-i, p);
+            if (r > RLE_MAX_RUN - s->run)
+                r = RLE_MAX_RUN - s->run;
+            s->run += r;
+            i += r;
+            continue;
+        }
+        if (o + (s->run ? 2 : 1) > n_out)
+            break;
+        if (s->run) {
+            out[o++] = RLE_REPEAT | s->run;
+            s->run = 0;
+        }
+        out[o++] = p;
+        s->last = p;
+        s->any = 1;
+        i++;
+    }
+    *n_in = i;
+    return o;
+}
+
+// emit open run (needs space for 1 word), return number of words emitted
+uint32_t rle_flush(rle_state_t *s, uint32_t *out) {
+    if (!s->run)
+        return 0;
+    out[0] = RLE_REPEAT | s->run;
+    s->run = 0;
+    return 1;
+}
@@ -0,0 +1,27 @@
+// rle.h
+
+#ifndef _RLE_H_
+#define _RLE_H_
+
+#include <stdint.h>
+
+// Run length encoding of 30 bit pixels as 32 bit words:
+//  bit 31 = 0 : literal pixel (bits 29..0)
+//  bit 31 = 1 : previous literal repeated (bits 30..0) more times
+// Longer runs are sent as several repeat words.
+
+#define RLE_PIXEL_MASK 0x3FFFFFFF
+#define RLE_REPEAT     0x80000000
+#define RLE_MAX_RUN    (RLE_REPEAT-1)
+
+typedef struct {
+    uint32_t last; // last literal
+    uint32_t run;  // repeats of last literal not yet emitted
+    int any;       // at least one literal has been emitted
+} rle_state_t;
+
+void rle_init(rle_state_t *s);
+uint32_t rle_encode(rle_state_t *s, const uint32_t *in, uint32_t *n_in, uint32_t *out, uint32_t n_out);
+uint32_t rle_flush(rle_state_t *s, uint32_t *out);
+
+#endif
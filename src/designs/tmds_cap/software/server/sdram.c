@@ -3,9 +3,44 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+// constant fill, 64 bytes per iteration once aligned
+static void sdram_set(uint32_t addr, uint32_t len, uint32_t d) {
+    uint32_t a = addr, end = addr+len;
+#ifdef __ARM_NEON
+    uint32x4_t v = vdupq_n_u32(d);
+#else
+    uint64_t v = ((uint64_t)d << 32) | d;
+#endif
+
+    for (; (a & 63) && a < end; a += 4)
+        *(uint32_t *)a = d;
+    for (; a+64 <= end; a += 64) {
+#ifdef __ARM_NEON
+        vst1q_u32((uint32_t *)a, v);
+        vst1q_u32((uint32_t *)(a+16), v);
+        vst1q_u32((uint32_t *)(a+32), v);
+        vst1q_u32((uint32_t *)(a+48), v);
+#else
+        uint64_t *p = (uint64_t *)a;
+        p[0] = v; p[1] = v; p[2] = v; p[3] = v;
+        p[4] = v; p[5] = v; p[6] = v; p[7] = v;
+#endif
+    }
+    for (; a < end; a += 4)
+        *(uint32_t *)a = d;
+}
+
 void sdram_fill(uint32_t addr, uint32_t len, uint32_t start, uint32_t incr) {
     uint32_t a, d;
 
+    if (!incr) {
+        sdram_set(addr, len, start);
+        return;
+    }
     d = start;
     for (a = addr; a < addr+len; a += 4) {
         *(uint32_t *)a = d;
@@ -17,6 +17,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "sleep.h"
@@ -24,33 +25,121 @@
 #include "hal.h"
 #include "sdram.h"
 #include "cap.h"
+#include "rle.h"
+#include "proto.h"
 #include "global.h"
-#include "csr.h" // debug only
+#include "csr.h"
 #include "dma.h" // debug only
 
 #include "lwip/tcp.h"
 #include "lwip/dhcp.h"
 #include "lwip/timeouts.h"
+#include "lwip/sys.h"
 void lwip_init();
 
-#define BYTES_PER_PIXEL 4
+#define BYTES_PER_WORD 4
 
-#define UDP_MAX_PAYLOAD 1472
 #define UDP_PORT        65400
 
 #define TCP_MAX_PAYLOAD 1460
 #define TCP_PORT        65401
 
-const char s_disco[]      = "tmds_cap disco";
+#define UDP_DATA_PORT   65402 // source port of blast datagrams
+#define BLAST_BURST     32    // datagrams per blast service pass
+#define BLAST_REFS      64    // blast datagrams that may be queued for transmission at once
+#define CRC_SAMPLE_MS   8     // signature count sample interval (faster than any field rate)
+
+#define RLE_BUF_WORDS   4096
+#define TEXT_MAX_LEN    64
+#define MAX_CONNS       4  // concurrent clients
+
+const char s_disco[]      = PROTO_DISCO_MAGIC;
 const char s_cmd_prefix[] = "tmds_cap";
 const char s_cmd_get[]    = "get";
+const char s_opt_dense[]  = "dense";
+const char s_opt_rle[]    = "rle";
 
 ip_addr_t broadcast;
 struct udp_pcb *udp_pcb_bcast;
-struct pbuf *udp_pbuf;
+
+struct udp_pcb *udp_pcb_data;
+
+// Blast datagrams refer to the buffer (no copy), and the network driver may
+// still hold them after udp_sendto() returns; the buffer must not be captured
+// into again until it has freed them all.
+#if !LWIP_SUPPORT_CUSTOM_PBUF
+#error blast datagrams need LWIP_SUPPORT_CUSTOM_PBUF
+#endif
+struct pbuf_custom blast_ref[BLAST_REFS];
+volatile int blast_ref_used[BLAST_REFS]; // cleared by blast_ref_free()
 
 struct tcp_pcb *tcp_pcb_listen;
-struct tcp_pcb *tcp_pcb_tx;
+
+// last capture (shared by all clients)
+uint32_t cap_req_pixels = 0;     // pixels requested
+uint32_t cap_req_flags = 0;      // PROTO_CAP_xxx
+uint32_t cap_req_words = 0;      // buffer words
+uint32_t cap_req_cfg[PROTO_TRIG_WORDS+PROTO_WIN_WORDS]; // trigger and window register values
+uint32_t cap_gen = 0;            // capture generation (incremented by every capture)
+int cap_stream = 0;              // capture is streamed through the ring (legacy text command)
+
+// video signatures (shared by all clients)
+uint32_t crc_count = 0;          // fields signed (CRCCOUNT as last sampled)
+u32_t crc_time;                  // time of last sample
+
+// telemetry (shared by all clients)
+proto_telem_t telem_ring[PROTO_TELEM_RING];
+uint32_t telem_seq = 0;          // records made
+uint32_t telem_interval = 0;     // ms (0 = no subscribers)
+u32_t telem_time;                // time of last record
+
+// client connection
+typedef struct {
+    struct tcp_pcb *pcb;         // NULL if unused
+    struct pbuf *rx_q;           // received request bytes not yet served
+    uint32_t gen;                // generation of this client's last capture (0 = none)
+    // transfer in progress
+    struct {
+        uint8_t cmd;             // command being served
+        uint8_t tag;             // tag of request being served
+        int framed;              // data is sent in response frames (else legacy stream)
+        int rle;                 // run length encoded
+        int release;             // release ring space as data is acknowledged
+        uint32_t pos;            // next buffer word to send
+        uint32_t end;            // buffer word after last to send
+        uint32_t acked;          // bytes acknowledged by client
+        uint32_t unacked;        // bytes of earlier responses not yet acknowledged at start
+        int udp;                 // sending blast datagrams (cleared once response is sent)
+        int ref;                 // TCP may refer to buffer (data written without copy, not all acknowledged)
+    } xfer;
+    // UDP blast
+    struct {
+        uint16_t port;           // client UDP port (0 = no blast set up)
+        uint32_t gen;            // generation of capture being sent
+        uint32_t base;           // buffer word of datagram 0
+        uint32_t end;            // buffer word after last
+        uint32_t nack[PROTO_MAX_REQ_LEN/4]; // datagrams to resend: (first, count) pairs
+        int nack_n;              // pairs
+        int nack_i;              // next pair
+    } blast;
+    // video signature stream
+    struct {
+        uint16_t port;           // client UDP port (0 = not subscribed)
+        uint32_t next;           // next field to send
+    } crc;
+    // telemetry stream
+    struct {
+        uint16_t port;           // client UDP port (0 = not subscribed)
+        uint32_t interval;       // ms
+        uint32_t next;           // next record to send
+    } telem;
+    rle_state_t rle_state;
+    uint32_t rle_buf[2+RLE_BUF_WORDS]; // room for frame header, then encoded words
+    uint32_t rle_out;            // encoded words
+    int rle_pend;                // RLE output not yet passed to tcp_write()
+} conn_t;
+
+conn_t conn[MAX_CONNS];
 
 void print_ip(char *msg, ip_addr_t *ip)
 {
@@ -59,72 +148,241 @@ void print_ip(char *msg, ip_addr_t *ip)
     fflush(stdout);
 }
 
-// broadcast advertisement (UDP)
+// broadcast advertisement (UDP), sent once: if it is lost the next one will do
 void advertise(const char *s)
 {
-    u16_t l = strlen(s);
+    struct pbuf *p;
+
+    p = pbuf_alloc(PBUF_TRANSPORT, strlen(s), PBUF_ROM); // refers to s (no copy)
+    if (!p)
+        return;
+    p->payload = (void *)s;
+    udp_sendto(udp_pcb_bcast, p, &broadcast, UDP_PORT);
+    pbuf_free(p);
+}
+
+// discovery query (UDP): reply at once, with a description of this server
+void server_udp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+    struct pbuf *r;
+    proto_disco_t *d;
+    int i;
+
+    if (p->tot_len == strlen(PROTO_DISCO_QUERY)
+        && !pbuf_memcmp(p, 0, PROTO_DISCO_QUERY, p->tot_len)
+    ) {
+        r = pbuf_alloc(PBUF_TRANSPORT, sizeof(proto_disco_t), PBUF_RAM);
+        if (r) {
+            d = r->payload;
+            memset(d, 0, sizeof(proto_disco_t));
+            strcpy(d->magic, PROTO_DISCO_MAGIC);
+            d->version = PROTO_VERSION;
+            d->signature = CSR_PEEK(RA_SIGNATURE);
+            d->buf_bytes = CAP_BUF_BYTES;
+            d->freq = CSR_PEEK(RA_FREQ);
+            d->astat = CSR_PEEK(RA_ASTAT);
+            d->tcp_port = TCP_PORT;
+            for (i = 0; i < MAX_CONNS; i++)
+                if (conn[i].pcb)
+                    d->clients++;
+            udp_sendto(pcb, r, addr, port); // client retries if lost
+            pbuf_free(r);
+        }
+    }
+    pbuf_free(p);
+}
+
+// driver has finished with a blast datagram (may be called from its interrupt handler)
+void blast_ref_free(struct pbuf *p)
+{
+    blast_ref_used[(struct pbuf_custom *)p - blast_ref] = 0;
+}
+
+// return a free blast datagram reference, or NULL if all are in use
+struct pbuf_custom *blast_ref_alloc()
+{
+    int i;
+
+    for (i = 0; i < BLAST_REFS; i++)
+        if (!blast_ref_used[i]) {
+            blast_ref_used[i] = 1;
+            blast_ref[i].custom_free_function = blast_ref_free;
+            return &blast_ref[i];
+        }
+    return NULL;
+}
+
+// return non-zero if any blast datagrams still refer to the buffer
+int blast_refs()
+{
+    int i;
+
+    for (i = 0; i < BLAST_REFS; i++)
+        if (blast_ref_used[i])
+            return 1;
+    return 0;
+}
+
+// data still to be sent
+int xfer_sending(conn_t *c)
+{
+    return c->xfer.pos < c->xfer.end || c->rle_pend || c->xfer.udp;
+}
+
+// data sent from the buffer without copying, not yet all acknowledged
+// (TCP may have to retransmit it, so the buffer must not be reused)
+int xfer_unacked(conn_t *c)
+{
+    if (c->xfer.ref && tcp_sndbuf(c->pcb) == TCP_SND_BUF)
+        c->xfer.ref = 0;
+    return c->xfer.ref;
+}
+
+int xfer_active(conn_t *c)
+{
+    return xfer_sending(c) || xfer_unacked(c);
+}
+
+// sample at the shortest interval asked for by any subscribed client
+void telem_config()
+{
+    conn_t *c;
+
+    telem_interval = 0;
+    for (c = conn; c < conn+MAX_CONNS; c++)
+        if (c->pcb && c->telem.port && (!telem_interval || c->telem.interval < telem_interval))
+            telem_interval = c->telem.interval;
+    telem_time = sys_now() - telem_interval; // sample at once
+}
+
+// make a telemetry record if one is due
+void telem_sample()
+{
+    proto_telem_t *t;
+    u32_t now = sys_now();
+    int i;
+
+    if (!telem_interval || now - telem_time < telem_interval)
+        return;
+    telem_time = now;
+    t = &telem_ring[telem_seq % PROTO_TELEM_RING];
+    t->seq = telem_seq;
+    t->time = now;
+    t->freq = CSR_PEEK(RA_FREQ);
+    t->astat = CSR_PEEK(RA_ASTAT);
+    t->atap = CSR_PEEK(RA_ATAP);
+    t->abitslip = CSR_PEEK(RA_ABITSLIP);
+    for (i = 0; i < 4; i++) {
+        t->again[i] = CSR_PEEK(RA_AGAIN0 + 4*i); // AGAINP follows AGAIN2
+        t->aloss[i] = CSR_PEEK(RA_ALOSS0 + 4*i); // ALOSSP follows ALOSS2
+    }
+    t->capstat = CSR_PEEK(RA_CAPSTAT);
+    t->capcount = CSR_PEEK(RA_CAPCOUNT);
+    telem_seq++;
+}
+
+// sample the signature count if due (register reads are slow, fields are not)
+void crc_sample()
+{
+    u32_t now = sys_now();
+
+    if (now - crc_time < CRC_SAMPLE_MS)
+        return;
+    crc_time = now;
+    crc_count = CSR_PEEK(RA_CRCCOUNT);
+}
+
+// return number of clients (other than c) with a transfer from the buffer in progress
+int xfer_others(conn_t *c)
+{
+    int i, n = 0;
 
-    udp_pbuf->payload = (void *)s;
-    udp_pbuf->len = l;
-    udp_pbuf->tot_len = l;
-    while (udp_sendto(udp_pcb_bcast, udp_pbuf, &broadcast, UDP_PORT) != ERR_OK);
+    for (i = 0; i < MAX_CONNS; i++)
+        if (&conn[i] != c && conn[i].pcb && xfer_active(&conn[i]))
+            n++;
+    return n;
 }
 
-void server_tcp_close(struct tcp_pcb *pcb)
+// abandon transfer and any queued requests, free connection
+void conn_free(conn_t *c)
 {
+    if (cap_stream && c->xfer.release && c->xfer.pos < c->xfer.end) {
+        cap_stop(); // streaming capture cannot continue without a consumer
+        cap_stream = 0;
+        cap_req_words = 0;
+    }
+    c->xfer.pos = c->xfer.end = 0;
+    c->rle_pend = 0;
+    if (c->rx_q) {
+        pbuf_free(c->rx_q);
+        c->rx_q = NULL;
+    }
+    c->pcb = NULL;
+    if (c->telem.port)
+        telem_config(); // this client's interval no longer applies
+}
+
+// close connection, return ERR_ABRT if it had to be aborted
+err_t server_tcp_close(conn_t *c)
+{
+  struct tcp_pcb *pcb = c->pcb;
+  err_t err = ERR_OK;
+
   tcp_arg(pcb, NULL);
   tcp_sent(pcb, NULL);
   tcp_recv(pcb, NULL);
   tcp_err(pcb, NULL);
   tcp_poll(pcb, NULL, 0);
-  tcp_close(pcb);
+  if (xfer_unacked(c)) {
+      tcp_abort(pcb); // a closing pcb would keep retransmitting from the buffer after it is reused
+      err = ERR_ABRT;
+  }
+  else
+      tcp_close(pcb);
+  conn_free(c);
+  return err;
 }
 
 err_t server_tcp_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
 {
-    char *s;
-    long n;
+    conn_t *c = arg;
 
     if (p) {
-        s = strtok((char *)p->payload, " ");
-        if (!strcmp(s_cmd_prefix,s)) {
-            s = strtok(NULL, " ");
-            if (!strcmp(s_cmd_get, s)) {
-                s = strtok(NULL, " ");
-                n = strtol(s, (char **)NULL, 10);
-                printf("client requested %ld pixels\r\n", n);
-                tcp_pcb_tx = pcb;
-                cap_start((uint32_t)n);
-            } else {
-                printf("received unknown command from client (%s)\r\n", s);
-            }
-        } else {
-            printf("received bad prefix from client (%s)\r\n", s);
-        }
-        tcp_recved(pcb, p->tot_len);
-        pbuf_free(p);
+        // queue for server_serve()
+        if (c->rx_q)
+            pbuf_cat(c->rx_q, p);
+        else
+            c->rx_q = p;
     }
     else {
         // no pbuf?
         printf("TCP connection closed\r\n");
-        server_tcp_close(pcb);
+        return server_tcp_close(c);
     }
     return ERR_OK;
 }
 
 err_t server_tcp_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
 {
-	// do nothing
-	return ERR_OK;
+    conn_t *c = arg;
+
+    // capture ring space can be reused once the client has acknowledged it
+    // (RLE data is copied, so ring space is released as it is encoded)
+    if (c->xfer.release && !c->xfer.rle) {
+        c->xfer.acked += len;
+        if (c->xfer.acked > c->xfer.unacked)
+            cap_release((c->xfer.acked-c->xfer.unacked)/BYTES_PER_WORD);
+    }
+    return ERR_OK;
 }
 
 void server_tcp_error(void *arg, err_t err)
 {
     printf("TCP error\r\n");
+    if (arg)
+        conn_free(arg); // pcb already freed
 }
 
-
-
 err_t server_tcp_poll(void *arg, struct tcp_pcb *pcb)
 {
     // do nothing
@@ -133,8 +391,23 @@ err_t server_tcp_poll(void *arg, struct tcp_pcb *pcb)
 
 err_t server_tcp_accept(void *arg, struct tcp_pcb *pcb, err_t err)
 {
-	printf("TCP connection accepted\r\n");
-    tcp_arg(pcb, NULL);
+    conn_t *c = NULL;
+    int i;
+
+    for (i = 0; i < MAX_CONNS; i++)
+        if (!conn[i].pcb) {
+            c = &conn[i];
+            break;
+        }
+    if (!c) {
+        printf("TCP connection refused (busy)\r\n");
+        tcp_abort(pcb);
+        return ERR_ABRT;
+    }
+	printf("TCP connection %d accepted\r\n", i);
+    memset(c, 0, sizeof(conn_t));
+    c->pcb = pcb;
+    tcp_arg(pcb, c);
     tcp_sent(pcb, server_tcp_sent);
     tcp_recv(pcb, server_tcp_recv);
     tcp_err(pcb, server_tcp_error);
@@ -142,20 +415,615 @@ err_t server_tcp_accept(void *arg, struct tcp_pcb *pcb, err_t err)
     return ERR_OK;
 }
 
-int pixels_remaining = 0;
-int pixels_sent = 0;
+// remove served request bytes from the receive queue
+void rx_drop(conn_t *c, uint16_t len)
+{
+    c->rx_q = pbuf_free_header(c->rx_q, len);
+    tcp_recved(c->pcb, len);
+}
+
+// send a complete response frame, return 0 if there is no room for it
+int respond(conn_t *c, uint8_t cmd, uint8_t status, uint8_t tag, const void *payload, uint32_t len)
+{
+    proto_hdr_t h;
+
+    if (tcp_sndbuf(c->pcb) < PROTO_HDR_BYTES + len)
+        return 0;
+    h.cmd = cmd;
+    h.flags = PROTO_FLAG_LAST;
+    h.status = status;
+    h.tag = tag;
+    h.len = len;
+    tcp_write(c->pcb, &h, PROTO_HDR_BYTES, TCP_WRITE_FLAG_COPY | (len ? TCP_WRITE_FLAG_MORE : 0));
+    if (len)
+        tcp_write(c->pcb, payload, len, TCP_WRITE_FLAG_COPY);
+    tcp_output(c->pcb);
+    return 1;
+}
+
+// CAP_xxx capture mode for PROTO_CAP_xxx flags
+static int cap_mode_of(uint32_t flags)
+{
+    return (flags & PROTO_CAP_PKT) ? CAP_PKT : (flags & PROTO_CAP_DENSE) ? CAP_DENSE : CAP_SPARSE;
+}
 
-// transfer captured data
-void transfer()
+// return nonzero if a capture fits in the buffer, without overflow for any
+// pixel count (dense captures are rounded up to 32 pixels by cap_start())
+static int cap_fits(uint32_t pixels, int mode)
 {
-    int n;
+    switch (mode) {
+        case CAP_DENSE:
+            return pixels/32 + (pixels%32 != 0) <= CAP_BUF_WORDS/CAP_WORDS(32, CAP_DENSE);
+        case CAP_PKT:
+            return pixels <= CAP_BUF_WORDS/CAP_PKT_WORDS;
+        default:
+            return pixels <= CAP_BUF_WORDS;
+    }
+}
 
-    n = tcp_sndbuf(tcp_pcb_tx)/BYTES_PER_PIXEL; // get send buffer space in pixels
+// start a capture, or reuse the last one if allowed and suitable
+// cfg: PROTO_TRIG_WORDS trigger words (TRIGCTRL, TRIGPRE, TRIGHDR, TRIGMASK) then
+// PROTO_WIN_WORDS window words (WINCTRL, WINLINE, WINPIX, WINSKIP), all zero for none
+uint8_t server_capture(conn_t *c, uint32_t pixels, uint32_t flags, const uint32_t *cfg)
+{
+    int mode = cap_mode_of(flags);
+
+    if ((flags & PROTO_CAP_REUSE) && cap_req_words && !cap_stream
+        && pixels <= cap_req_pixels && mode == cap_mode_of(cap_req_flags)
+        && !memcmp(cfg, cap_req_cfg, sizeof(cap_req_cfg))) {
+        c->gen = cap_gen;
+        return PROTO_OK;
+    }
+    if (cap_stream || xfer_others(c))
+        return PROTO_E_BUSY; // other clients are reading the buffer
+    cap_req_pixels = pixels;
+    cap_req_flags = flags & ~PROTO_CAP_REUSE;
+    memcpy(cap_req_cfg, cfg, sizeof(cap_req_cfg));
+    cap_trigger(cfg[0], cfg[1], cfg[2], cfg[3]);
+    cap_window(cfg[4], cfg[5], cfg[6], cfg[7]);
+    cap_req_words = cap_start(pixels, mode);
+    cap_stream = cap_req_words > CAP_BUF_WORDS;
+    c->gen = ++cap_gen;
+    return PROTO_OK;
+}
+
+// check that a range (a[0] = pixel offset, a[1] = pixel count) of a capture is available
+uint8_t check_range(const uint32_t *a, uint32_t gen)
+{
+    if (!a[1])
+        return PROTO_E_ARG;
+    if (cap_stream)
+        return PROTO_E_BUSY;
+    if (gen != cap_gen)
+        return PROTO_E_STALE; // overwritten by a later capture
+    if (!cap_req_words || a[0] >= cap_req_pixels || a[1] > cap_req_pixels-a[0])
+        return PROTO_E_RANGE;
+    if ((cap_req_flags & PROTO_CAP_DENSE) && (a[0] % 16))
+        return PROTO_E_ARG; // dense data is fetched in groups of 16 pixels
+    return PROTO_OK;
+}
+
+// legacy text command: "tmds_cap get N [dense] [rle]"
+// Captures and streams N pixels, without framing. Captures may exceed the buffer.
+void serve_text(conn_t *c)
+{
+    char t[TEXT_MAX_LEN+1];
+    static const uint32_t no_cfg[PROTO_TRIG_WORDS+PROTO_WIN_WORDS] = { 0 };
+    char *s;
+    long n;
+    int dense, compress;
+    uint16_t l;
+
+    l = c->rx_q->tot_len > TEXT_MAX_LEN ? TEXT_MAX_LEN : c->rx_q->tot_len;
+    pbuf_copy_partial(c->rx_q, t, l, 0);
+    t[l] = 0;
+    rx_drop(c, c->rx_q->tot_len);
+    s = strtok(t, " ");
+    if (!s || strcmp(s_cmd_prefix,s)) {
+        printf("received bad prefix from client (%s)\r\n", s);
+        return;
+    }
+    s = strtok(NULL, " ");
+    if (!s || strcmp(s_cmd_get, s)) {
+        printf("received unknown command from client (%s)\r\n", s);
+        return;
+    }
+    s = strtok(NULL, " ");
+    n = s ? strtol(s, (char **)NULL, 10) : 0;
+    dense = compress = 0;
+    while ((s = strtok(NULL, " "))) {
+        if (!strcmp(s_opt_dense, s))
+            dense = 1;
+        else if (!strcmp(s_opt_rle, s))
+            compress = 1;
+    }
+    if (compress)
+        dense = 0; // RLE works on whole pixels
+    printf("client requested %ld pixels%s%s\r\n", n, dense ? " (dense)" : "", compress ? " (rle)" : "");
+    if (n > 0 && (unsigned long)n <= CAP_MAX_PIXELS) {
+        if (server_capture(c, (uint32_t)n, dense ? PROTO_CAP_DENSE : 0, no_cfg) != PROTO_OK) {
+            printf("capture refused (buffer in use by other clients)\r\n");
+            server_tcp_close(c); // no way to report an error in the legacy stream
+            return;
+        }
+        c->xfer.framed = 0;
+        c->xfer.rle = compress;
+        c->xfer.release = 1;
+        c->xfer.pos = 0;
+        c->xfer.end = CAP_WORDS((uint32_t)n, dense ? CAP_DENSE : CAP_SPARSE);
+        c->xfer.acked = 0;
+        c->xfer.unacked = TCP_SND_BUF - tcp_sndbuf(c->pcb);
+        rle_init(&c->rle_state);
+    }
+}
+
+// serve a binary request, return 0 if it is incomplete or must wait for send buffer space
+int serve_frame(conn_t *c)
+{
+    proto_hdr_t h;
+    uint32_t a[PROTO_MAX_REQ_LEN/4];
+    uint32_t r[PROTO_REGS];
+    proto_status_t st;
+    proto_timing_t tm;
+    uint32_t pixels, gen, i;
+    uint8_t status;
+
+    if (c->rx_q->tot_len < PROTO_HDR_BYTES)
+        return 0;
+    pbuf_copy_partial(c->rx_q, &h, PROTO_HDR_BYTES, 0);
+    if (h.len > PROTO_MAX_REQ_LEN) {
+        printf("request too long (%lu bytes)\r\n", (unsigned long)h.len);
+        server_tcp_close(c);
+        return 0;
+    }
+    if (c->rx_q->tot_len < PROTO_HDR_BYTES + h.len)
+        return 0;
+    memset(a, 0, sizeof(a));
+    pbuf_copy_partial(c->rx_q, a, h.len, PROTO_HDR_BYTES);
+
+    switch(h.cmd) {
+
+        case PROTO_CMD_CAPTURE:
+            if (tcp_sndbuf(c->pcb) < PROTO_HDR_BYTES+8 || blast_refs())
+                return 0;
+            pixels = a[0];
+            if ((h.len != 8 && h.len != 8+4*PROTO_TRIG_WORDS && h.len != 8+4*(PROTO_TRIG_WORDS+PROTO_WIN_WORDS))
+                || !pixels || (a[2] & ~(CSR_TRIGCTRL_MODE|CSR_TRIGCTRL_VSFALL))
+                || (a[6] & ~(CSR_WINCTRL_EN|CSR_WINCTRL_HPOL|CSR_WINCTRL_VPOL))
+                || ((a[1] & PROTO_CAP_PKT) && (a[1] & PROTO_CAP_DENSE)))
+                status = PROTO_E_ARG;
+            else if (!cap_fits(pixels, cap_mode_of(a[1])))
+                status = PROTO_E_SIZE; // framed captures cannot be streamed
+            else
+                status = server_capture(c, pixels, a[1], &a[2]); // trigger and window words are zero if absent
+            if (status != PROTO_OK)
+                c->gen = 0; // no valid capture to get
+            rx_drop(c, PROTO_HDR_BYTES + h.len);
+            r[0] = cap_req_words;
+            r[1] = c->gen;
+            respond(c, h.cmd, status, h.tag, r, status == PROTO_OK ? 8 : 0);
+            break;
+
+        case PROTO_CMD_GET:
+            if (tcp_sndbuf(c->pcb) < PROTO_HDR_BYTES)
+                return 0;
+            rx_drop(c, PROTO_HDR_BYTES + h.len);
+            gen = a[3] ? a[3] : c->gen ? c->gen : cap_gen; // this client's capture, else the latest
+            if ((h.len != 12 && h.len != 16) || ((a[2] & PROTO_GET_RLE) && cap_mode_of(cap_req_flags) != CAP_SPARSE))
+                status = PROTO_E_ARG;
+            else
+                status = check_range(a, gen);
+            if (status != PROTO_OK) {
+                respond(c, h.cmd, status, h.tag, NULL, 0);
+                break;
+            }
+            c->xfer.cmd = h.cmd;
+            c->xfer.tag = h.tag;
+            c->xfer.framed = 1;
+            c->xfer.rle = a[2] & PROTO_GET_RLE;
+            c->xfer.release = 0;
+            c->xfer.pos = CAP_WORDS(a[0], cap_mode_of(cap_req_flags));
+            c->xfer.end = CAP_WORDS(a[0]+a[1], cap_mode_of(cap_req_flags));
+            if (c->xfer.rle)
+                rle_init(&c->rle_state);
+            else {
+                h.flags = PROTO_FLAG_LAST;
+                h.status = PROTO_OK;
+                h.len = (c->xfer.end-c->xfer.pos) * BYTES_PER_WORD;
+                tcp_write(c->pcb, &h, PROTO_HDR_BYTES, TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE);
+            }
+            break;
+
+        case PROTO_CMD_BLAST:
+            if (tcp_sndbuf(c->pcb) < PROTO_HDR_BYTES)
+                return 0;
+            rx_drop(c, PROTO_HDR_BYTES + h.len);
+            gen = a[4] ? a[4] : c->gen ? c->gen : cap_gen;
+            if ((h.len != 16 && h.len != 20) || a[2] || !a[3] || a[3] > 0xFFFF)
+                status = PROTO_E_ARG;
+            else
+                status = check_range(a, gen);
+            if (status != PROTO_OK) {
+                respond(c, h.cmd, status, h.tag, NULL, 0);
+                break;
+            }
+            c->xfer.cmd = h.cmd;
+            c->xfer.tag = h.tag;
+            c->xfer.framed = 1;
+            c->xfer.rle = 0;
+            c->xfer.release = 0;
+            c->xfer.pos = CAP_WORDS(a[0], cap_mode_of(cap_req_flags));
+            c->xfer.end = CAP_WORDS(a[0]+a[1], cap_mode_of(cap_req_flags));
+            c->xfer.udp = 1;
+            c->blast.port = a[3];
+            c->blast.gen = gen;
+            c->blast.base = c->xfer.pos;
+            c->blast.end = c->xfer.end;
+            c->blast.nack_n = c->blast.nack_i = 0;
+            break;
+
+        case PROTO_CMD_RESEND:
+            if (tcp_sndbuf(c->pcb) < PROTO_HDR_BYTES)
+                return 0;
+            rx_drop(c, PROTO_HDR_BYTES + h.len);
+            if (!h.len || h.len % 8)
+                status = PROTO_E_ARG;
+            else if (!c->blast.port)
+                status = PROTO_E_RANGE; // no blast to resend from
+            else if (c->blast.gen != cap_gen || cap_stream)
+                status = PROTO_E_STALE;
+            else
+                status = PROTO_OK;
+            if (status != PROTO_OK) {
+                respond(c, h.cmd, status, h.tag, NULL, 0);
+                break;
+            }
+            c->xfer.cmd = h.cmd;
+            c->xfer.tag = h.tag;
+            c->xfer.pos = c->xfer.end = 0;
+            c->xfer.udp = 1;
+            memcpy(c->blast.nack, a, h.len);
+            c->blast.nack_n = h.len / 8;
+            c->blast.nack_i = 0;
+            break;
+
+        case PROTO_CMD_STATUS:
+            st.pixels = cap_req_pixels;
+            st.flags = cap_req_flags;
+            st.words = cap_req_words;
+            st.captured = cap_poll();
+            st.capstat = CSR_PEEK(RA_CAPSTAT);
+            st.freq = CSR_PEEK(RA_FREQ);
+            st.gen = cap_gen;
+            if (!respond(c, h.cmd, PROTO_OK, h.tag, &st, sizeof(st)))
+                return 0;
+            rx_drop(c, PROTO_HDR_BYTES + h.len);
+            break;
+
+        case PROTO_CMD_TIMING:
+            tm.stat = CSR_PEEK(RA_VTMSTAT);
+            i = CSR_PEEK(RA_VTMH0);
+            tm.h_total = i & 0xFFFF;
+            tm.h_active = i >> 16;
+            i = CSR_PEEK(RA_VTMH1);
+            tm.h_front_porch = i & 0xFFFF;
+            tm.h_sync = i >> 16;
+            tm.h_back_porch = CSR_PEEK(RA_VTMH2);
+            i = CSR_PEEK(RA_VTMV0);
+            tm.v_total = i & 0xFFFF;
+            tm.v_active = i >> 16;
+            i = CSR_PEEK(RA_VTMV1);
+            tm.v_front_porch = i & 0xFFFF;
+            tm.v_sync = i >> 16;
+            tm.v_back_porch = CSR_PEEK(RA_VTMV2);
+            tm.f_total = CSR_PEEK(RA_VTMF);
+            tm.freq = CSR_PEEK(RA_FREQ);
+            if (!respond(c, h.cmd, PROTO_OK, h.tag, &tm, sizeof(tm)))
+                return 0;
+            rx_drop(c, PROTO_HDR_BYTES + h.len);
+            break;
+
+        case PROTO_CMD_CRC:
+            if (tcp_sndbuf(c->pcb) < PROTO_HDR_BYTES+4)
+                return 0;
+            rx_drop(c, PROTO_HDR_BYTES + h.len);
+            if (h.len != 4 || a[0] > 0xFFFF) {
+                respond(c, h.cmd, PROTO_E_ARG, h.tag, NULL, 0);
+                break;
+            }
+            c->crc.port = a[0];
+            crc_count = CSR_PEEK(RA_CRCCOUNT);
+            c->crc.next = crc_count; // from the next field
+            respond(c, h.cmd, PROTO_OK, h.tag, &c->crc.next, 4);
+            break;
+
+        case PROTO_CMD_TELEM:
+            if (tcp_sndbuf(c->pcb) < PROTO_HDR_BYTES+8)
+                return 0;
+            rx_drop(c, PROTO_HDR_BYTES + h.len);
+            if (h.len != 8 || a[0] > 0xFFFF || (a[0] && a[1] < PROTO_TELEM_MIN_MS)) {
+                respond(c, h.cmd, PROTO_E_ARG, h.tag, NULL, 0);
+                break;
+            }
+            c->telem.port = a[0];
+            c->telem.interval = a[1];
+            c->telem.next = telem_seq; // from the next record
+            telem_config();
+            r[0] = telem_interval;
+            r[1] = c->telem.next;
+            respond(c, h.cmd, PROTO_OK, h.tag, r, 8);
+            break;
+
+        case PROTO_CMD_REGS:
+            for (i = 0; i < PROTO_REGS; i++)
+                r[i] = CSR_PEEK(4*i);
+            if (!respond(c, h.cmd, PROTO_OK, h.tag, r, sizeof(r)))
+                return 0;
+            rx_drop(c, PROTO_HDR_BYTES + h.len);
+            break;
+
+        default:
+            if (!respond(c, h.cmd, PROTO_E_CMD, h.tag, NULL, 0))
+                return 0;
+            rx_drop(c, PROTO_HDR_BYTES + h.len);
+            break;
+
+    }
+    return 1;
+}
+
+// transfer captured data as it becomes available
+void transfer(conn_t *c)
+{
+    uint32_t n, i, l;
+
+    n = cap_poll(); // captured
+    n = n > c->xfer.pos ? n-c->xfer.pos : 0; // captured but not yet sent
+    if (n > c->xfer.end-c->xfer.pos)
+        n = c->xfer.end-c->xfer.pos; // dense captures are rounded up
+    l = tcp_sndbuf(c->pcb)/BYTES_PER_WORD; // get send buffer space in words
+    if (n > l)
+        n = l;
+    i = c->xfer.pos % CAP_BUF_WORDS; // position in ring
+    if (n > CAP_BUF_WORDS-i)
+        n = CAP_BUF_WORDS-i;
     if (n) {
-        if (n > pixels_remaining)
-            n = pixels_remaining;
-        if (tcp_write(tcp_pcb_tx,(void *)&cap_buf[pixels_sent],n * BYTES_PER_PIXEL,0) == ERR_OK) {
-            pixels_sent += n; pixels_remaining -= n;
+        if (tcp_write(c->pcb,(void *)&cap_buf[i],n * BYTES_PER_WORD,0) == ERR_OK) {
+            c->xfer.pos += n;
+            c->xfer.ref = 1;
+            tcp_output(c->pcb);
+        }
+    }
+    else if (cap_overrun()) {
+        printf("capture overrun after %lu words\r\n", (unsigned long)c->xfer.pos);
+        server_tcp_close(c);
+    }
+}
+
+// send blast datagrams as data becomes available, then resend any that the
+// client reports missing; respond (over TCP) with the datagram count when done
+void transfer_udp(conn_t *c)
+{
+    uint32_t n, i, k, seq, count;
+    struct pbuf *h, *p;
+    struct pbuf_custom *r;
+    uint32_t *w;
+    err_t err;
+
+    count = (c->blast.end - c->blast.base + PROTO_BLAST_WORDS-1) / PROTO_BLAST_WORDS;
+    for (k = 0; k < BLAST_BURST; k++) {
+        if (c->xfer.pos == c->xfer.end) {
+            if (c->blast.nack_i == c->blast.nack_n)
+                break;
+            // next range to resend
+            seq = c->blast.nack[2*c->blast.nack_i];
+            n = c->blast.nack[2*c->blast.nack_i+1];
+            c->blast.nack_i++;
+            if (seq >= count)
+                continue;
+            if (n > count-seq)
+                n = count-seq;
+            c->xfer.pos = c->blast.base + seq * PROTO_BLAST_WORDS;
+            c->xfer.end = c->xfer.pos + n * PROTO_BLAST_WORDS;
+            if (c->xfer.end > c->blast.end)
+                c->xfer.end = c->blast.end;
+        }
+        n = cap_poll(); // captured
+        n = n > c->xfer.pos ? n-c->xfer.pos : 0; // captured but not yet sent
+        if (n > c->xfer.end-c->xfer.pos)
+            n = c->xfer.end-c->xfer.pos;
+        if (n < PROTO_BLAST_WORDS && n < c->xfer.end-c->xfer.pos) {
+            if (!n && cap_overrun()) {
+                printf("capture overrun after %lu words\r\n", (unsigned long)c->xfer.pos);
+                server_tcp_close(c);
+                return;
+            }
+            break; // wait for a whole datagram
+        }
+        if (n > PROTO_BLAST_WORDS)
+            n = PROTO_BLAST_WORDS;
+        // datagram = header + reference to buffer (no copy)
+        h = pbuf_alloc(PBUF_TRANSPORT, PROTO_BLAST_HDR_BYTES, PBUF_RAM);
+        if (!h)
+            break;
+        r = blast_ref_alloc();
+        if (!r) {
+            pbuf_free(h);
+            break; // wait for the driver to free some
+        }
+        i = c->xfer.pos % CAP_BUF_WORDS; // position in ring
+        p = pbuf_alloced_custom(PBUF_RAW, n * BYTES_PER_WORD, PBUF_REF, r,
+            (void *)&cap_buf[i], n * BYTES_PER_WORD);
+        pbuf_cat(h, p);
+        w = h->payload;
+        w[0] = (c->xfer.pos - c->blast.base) / PROTO_BLAST_WORDS;
+        w[1] = c->blast.gen;
+        err = udp_sendto(udp_pcb_data, h, &c->pcb->remote_ip, c->blast.port);
+        pbuf_free(h);
+        if (err != ERR_OK)
+            break; // retry later
+        c->xfer.pos += n;
+    }
+    if (c->xfer.pos == c->xfer.end && c->blast.nack_i == c->blast.nack_n)
+        if (respond(c, c->xfer.cmd, PROTO_OK, c->xfer.tag, &count, sizeof(count)))
+            c->xfer.udp = 0;
+}
+
+// send new video signatures (as one datagram)
+void stream_crc(conn_t *c)
+{
+    uint32_t count, n, i;
+    struct pbuf *p;
+    proto_crc_t *s;
+
+    n = crc_count - c->crc.next;
+    if (!n)
+        return;
+    if (n > PROTO_CRC_RING) {
+        c->crc.next = crc_count - PROTO_CRC_RING; // older signatures overwritten
+        n = PROTO_CRC_RING;
+    }
+    p = pbuf_alloc(PBUF_TRANSPORT, n * sizeof(proto_crc_t), PBUF_RAM);
+    if (!p)
+        return; // retry later
+    s = p->payload;
+    for (i = 0; i < n; i++) { // oldest first: the next to be overwritten
+        s[i].field = c->crc.next + i;
+        s[i].crc = CSR_PEEK(RA_CRCRING + 4*((c->crc.next + i) % PROTO_CRC_RING));
+    }
+    // drop any overwritten before they were read (the sampled count may be a field behind)
+    count = CSR_PEEK(RA_CRCCOUNT);
+    i = count - c->crc.next > PROTO_CRC_RING ? count - c->crc.next - PROTO_CRC_RING : 0;
+    if (i < n && !pbuf_remove_header(p, i * sizeof(proto_crc_t))
+        && udp_sendto(udp_pcb_data, p, &c->pcb->remote_ip, c->crc.port) == ERR_OK)
+        c->crc.next = crc_count;
+    pbuf_free(p);
+}
+
+// send new telemetry records (as one datagram)
+void stream_telem(conn_t *c)
+{
+    uint32_t n, i;
+    struct pbuf *p;
+    proto_telem_t *t;
+
+    n = telem_seq - c->telem.next;
+    if (!n)
+        return;
+    if (n > PROTO_TELEM_RING) {
+        c->telem.next = telem_seq - PROTO_TELEM_RING; // older records overwritten
+        n = PROTO_TELEM_RING;
+    }
+    if (n > PROTO_TELEM_PER_DGRAM)
+        n = PROTO_TELEM_PER_DGRAM; // rest go next time
+    p = pbuf_alloc(PBUF_TRANSPORT, n * sizeof(proto_telem_t), PBUF_RAM);
+    if (!p)
+        return; // retry later
+    t = p->payload;
+    for (i = 0; i < n; i++)
+        t[i] = telem_ring[(c->telem.next + i) % PROTO_TELEM_RING];
+    if (udp_sendto(udp_pcb_data, p, &c->pcb->remote_ip, c->telem.port) == ERR_OK)
+        c->telem.next += n;
+    pbuf_free(p);
+}
+
+// pass RLE output to TCP (with a frame header if required)
+void rle_write(conn_t *c)
+{
+    uint8_t *p = (uint8_t *)&c->rle_buf[2];
+    uint32_t l = c->rle_out * BYTES_PER_WORD;
+    proto_hdr_t *h;
+
+    if (c->xfer.framed) {
+        p -= PROTO_HDR_BYTES;
+        h = (proto_hdr_t *)p;
+        h->cmd = c->xfer.cmd;
+        h->flags = c->xfer.pos == c->xfer.end ? PROTO_FLAG_LAST : 0;
+        h->status = PROTO_OK;
+        h->tag = c->xfer.tag;
+        h->len = l;
+        l += PROTO_HDR_BYTES;
+    }
+    if (l && tcp_write(c->pcb,p,l,TCP_WRITE_FLAG_COPY) != ERR_OK)
+        return; // retry later
+    c->rle_pend = 0;
+    tcp_output(c->pcb);
+}
+
+// transfer captured data as it becomes available, run length encoded
+void transfer_rle(conn_t *c)
+{
+    uint32_t n, i, l;
+
+    // retry previous output first
+    if (c->rle_pend) {
+        rle_write(c);
+        return;
+    }
+
+    n = cap_poll(); // captured
+    n = n > c->xfer.pos ? n-c->xfer.pos : 0; // captured but not yet encoded
+    if (n > c->xfer.end-c->xfer.pos)
+        n = c->xfer.end-c->xfer.pos;
+    i = c->xfer.pos % CAP_BUF_WORDS; // position in ring
+    if (n > CAP_BUF_WORDS-i)
+        n = CAP_BUF_WORDS-i;
+    l = tcp_sndbuf(c->pcb)/BYTES_PER_WORD; // get send buffer space in words
+    l = l > 2 ? l-2 : 0; // less frame header
+    if (l > RLE_BUF_WORDS)
+        l = RLE_BUF_WORDS;
+    if (n && l >= 3) {
+        c->rle_out = rle_encode(&c->rle_state,(uint32_t *)&cap_buf[i],&n,&c->rle_buf[2],l-1); // leave room for flush
+        c->xfer.pos += n;
+        if (c->xfer.release)
+            cap_release(c->xfer.pos);
+        if (c->xfer.pos == c->xfer.end)
+            c->rle_out += rle_flush(&c->rle_state,&c->rle_buf[2+c->rle_out]);
+        if (c->rle_out || c->xfer.pos == c->xfer.end) { // not just a longer open run
+            c->rle_pend = 1;
+            rle_write(c);
+        }
+    }
+    else if (!n && cap_overrun()) {
+        printf("capture overrun after %lu words\r\n", (unsigned long)c->xfer.pos);
+        server_tcp_close(c);
+    }
+}
+
+// serve queued requests and transfers in progress, for each client in turn
+void server_serve()
+{
+    conn_t *c;
+
+    for (c = conn; c < conn+MAX_CONNS; c++) {
+        while (c->pcb && c->rx_q && !xfer_active(c)) {
+            if (((uint8_t *)c->rx_q->payload)[0] == s_cmd_prefix[0]) {
+                if (blast_refs())
+                    break; // a text command always captures: wait for blast datagrams to be freed
+                serve_text(c);
+            }
+            else if (!serve_frame(c))
+                break;
+        }
+        if (c->pcb && xfer_sending(c)) {
+            if (c->xfer.udp)
+                transfer_udp(c);
+            else if (c->xfer.rle)
+                transfer_rle(c);
+            else
+                transfer(c);
+        }
+        if (c->pcb && c->crc.port)
+            stream_crc(c);
+        if (c->pcb && c->telem.port)
+            stream_telem(c);
+        if (c->pcb && c->xfer.release && !xfer_active(c)) {
+            // legacy capture sent and acknowledged
+            c->xfer.release = 0;
+            if (cap_stream) {
+                cap_stream = 0; // ring no longer holds the whole capture
+                cap_req_words = 0;
+            }
         }
     }
 }
@@ -186,8 +1054,9 @@ void server_init()
     udp_pcb_bcast = udp_new();
     ip_set_option(udp_pcb_bcast, SOF_BROADCAST);
     udp_bind(udp_pcb_bcast, IP_ADDR_ANY, UDP_PORT ) ;
-    udp_connect(udp_pcb_bcast, IP_ADDR_ANY, UDP_PORT);
-    udp_pbuf = pbuf_alloc(PBUF_TRANSPORT, UDP_MAX_PAYLOAD, PBUF_RAM);
+    udp_recv(udp_pcb_bcast, server_udp_recv, NULL); // not connected: queries come from any port
+    udp_pcb_data = udp_new();
+    udp_bind(udp_pcb_data, IP_ADDR_ANY, UDP_DATA_PORT);
 
     // TCP setup
     tcp_pcb_listen = tcp_new();
@@ -196,27 +1065,32 @@ void server_init()
     tcp_accept(tcp_pcb_listen, server_tcp_accept);
 }
 
-// establish IP address
+// establish IP address (unless the HAL has set a static one)
 void server_dhcp()
 {
-    printf("\r\nDHCP: starting... ");
-    fflush(stdout);
-    dhcp_start(&Eth0);
-    countdown = COUNTDOWN_SEC * 30; // 30 seconds
-    while((Eth0.ip_addr.addr == 0) && (countdown > 0)) {
-        hal_netif_rx(&Eth0);
-        sys_check_timeouts();
-    }
-    if (countdown <= 0) {
-        if ((Eth0.ip_addr.addr) == 0) {
-            printf("timeout - configuring defaults\r\n");
-            IP4_ADDR(&Eth0.ip_addr, 192, 168,   1, 123);
-            IP4_ADDR(&Eth0.netmask, 255, 255, 255,   0);
-            IP4_ADDR(&Eth0.gw,      192, 168,   1,   1);
-        }
+    if (Eth0.ip_addr.addr) {
+        printf("\r\nstatic IPv4 address (set by HAL)\r\n");
     }
     else {
-        printf("done\r\n");
+        printf("\r\nDHCP: starting... ");
+        fflush(stdout);
+        dhcp_start(&Eth0);
+        countdown = COUNTDOWN_SEC * 30; // 30 seconds
+        while((Eth0.ip_addr.addr == 0) && (countdown > 0)) {
+            hal_netif_rx(&Eth0);
+            sys_check_timeouts();
+        }
+        if (countdown <= 0) {
+            if ((Eth0.ip_addr.addr) == 0) {
+                printf("timeout - configuring defaults\r\n");
+                IP4_ADDR(&Eth0.ip_addr, 192, 168,   1, 123);
+                IP4_ADDR(&Eth0.netmask, 255, 255, 255,   0);
+                IP4_ADDR(&Eth0.gw,      192, 168,   1,   1);
+            }
+        }
+        else {
+            printf("done\r\n");
+        }
     }
 
     // display IPv4 setup
@@ -244,13 +1118,10 @@ void server_run()
             advertise(s_disco);
         }
 
-        // transfer pixels as required
-        if (pixels_remaining) {
-            transfer();
-        }
-        else {
-        	pixels_sent = 0;
-            pixels_remaining = cap_rdy();
-        }
+        // serve requests, transfer pixels as they are captured
+        cap_poll();
+        crc_sample();
+        telem_sample();
+        server_serve();
     }
 }
@@ -14,6 +14,11 @@
 #include "lwip/timeouts.h"
 
 #include "global.h"
+#include "cap.h"
+#include "dma.h"
+
+#define CAP_IRQ_ID XPAR_FABRIC_CAP_IRQ_INTR
+#define DMA_IRQ_ID XPAR_FABRIC_AXI_DMA_S2MM_INTROUT_INTR
 
 #define ISR_COUNT_LINK_DET    (LINK_DET_INTERVAL_MSECS/SCUTIMER_INTERVAL_MSECS)
 #define ISR_COUNT_DHCP_FINE   (SCUTIMER_INTERVAL_MSECS/DHCP_FINE_TIMER_MSECS)
@@ -47,6 +52,20 @@ void isr_timer(XScuTimer *pXScuTimer)
     XScuTimer_ClearInterruptStatus(pXScuTimer);
 }
 
+// DMA transfer complete (or error)
+void isr_dma(void *p)
+{
+    dma_irq_ack();
+    cap_event = 1;
+}
+
+// capture stopped (or FIFO overflow)
+void isr_cap(void *p)
+{
+    cap_irq_ack();
+    cap_event = 1;
+}
+
 void hal_init(void)
 {
     //Xil_DCacheDisable();
@@ -77,6 +96,24 @@ void hal_init(void)
         (void *)&XScuTimer0
     );
     XScuGic_EnableIntr(XPAR_SCUGIC_0_DIST_BASEADDR, XPAR_SCUTIMER_INTR);
+
+    // fabric interrupts (level sensitive)
+    XScuGic_SetPriTrigTypeByDistAddr(XPAR_SCUGIC_0_DIST_BASEADDR, DMA_IRQ_ID, 0xA0, 1);
+    XScuGic_RegisterHandler(
+        XPAR_SCUGIC_0_CPU_BASEADDR,
+        DMA_IRQ_ID,
+        (Xil_ExceptionHandler)isr_dma,
+        NULL
+    );
+    XScuGic_EnableIntr(XPAR_SCUGIC_0_DIST_BASEADDR, DMA_IRQ_ID);
+    XScuGic_SetPriTrigTypeByDistAddr(XPAR_SCUGIC_0_DIST_BASEADDR, CAP_IRQ_ID, 0xA0, 1);
+    XScuGic_RegisterHandler(
+        XPAR_SCUGIC_0_CPU_BASEADDR,
+        CAP_IRQ_ID,
+        (Xil_ExceptionHandler)isr_cap,
+        NULL
+    );
+    XScuGic_EnableIntr(XPAR_SCUGIC_0_DIST_BASEADDR, CAP_IRQ_ID);
 }
 
 void hal_enable_interrupts(void)
@@ -17,11 +17,13 @@ package TestCtrl_pkg is
       USER_WIDTH : integer
     );
     port (
-      rst_n    : in    std_logic;
-      tpclk    : out   time := 10 ns;
-      cap_size : out   std_logic_vector(31 downto 0);
-      cap_test : out   std_logic;
-      RxRec    : inout StreamRecType
+      rst_n     : in    std_logic;
+      tpclk     : out   time := 10 ns;
+      cap_size  : out   std_logic_vector(31 downto 0);
+      cap_chunk : out   std_logic_vector(31 downto 0);
+      cap_test  : out   std_logic;
+      cap_dense : out   std_logic;
+      RxRec     : inout StreamRecType
     );
   end component TestCtrl;
 
@@ -51,11 +53,13 @@ entity TestCtrl is
   );
 
   port (
-    rst_n    : in    std_logic;
-    tpclk    : out   time := 10 ns;
-    cap_size : out   std_logic_vector(31 downto 0);
-    cap_test : out   std_logic;
-    RxRec    : inout StreamRecType
+    rst_n     : in    std_logic;
+    tpclk     : out   time := 10 ns;
+    cap_size  : out   std_logic_vector(31 downto 0);
+    cap_chunk : out   std_logic_vector(31 downto 0);
+    cap_test  : out   std_logic;
+    cap_dense : out   std_logic;
+    RxRec     : inout StreamRecType
   );
 
   constant DATA_WIDTH  : integer := RxRec.DataFromModel'length;
@@ -30,8 +30,11 @@ architecture sim of tb_tmds_cap_stream is
   signal tmds       : slv10_vector(0 to 2);
   signal cap_rst    : std_logic;
   signal cap_size   : std_logic_vector(31 downto 0);
+  signal cap_chunk  : std_logic_vector(31 downto 0);
   signal cap_en     : std_logic;
   signal cap_test   : std_logic;
+  signal cap_dense  : std_logic;
+  signal cap_arm    : std_logic;
   signal cap_run    : std_logic;
   signal cap_stop   : std_logic;
   signal cap_loss   : std_logic;
@@ -124,8 +127,23 @@ begin
       tmds        => tmds,
       cap_rst     => cap_rst,
       cap_size    => cap_size,
+      cap_chunk   => cap_chunk,
       cap_en      => cap_en,
       cap_test    => cap_test,
+      cap_dense   => cap_dense,
+      cap_pkt     => '0',
+      trig_mode   => "00",
+      trig_vpol   => '0',
+      trig_pre    => (others => '0'),
+      trig_hdr    => (others => '0'),
+      trig_mask   => (others => '0'),
+      win_en      => '0',
+      win_hpol    => '0',
+      win_vpol    => '0',
+      win_line    => (others => '0'),
+      win_pix     => (others => '0'),
+      win_skip    => (others => '0'),
+      cap_arm     => cap_arm,
       cap_run     => cap_run,
       cap_stop    => cap_stop,
       cap_loss    => cap_loss,
@@ -159,11 +177,13 @@ begin
       USER_WIDTH => TUSER_WIDTH
     )
     port map (
-      rst_n    => axi_rst_n,
-      tpclk    => tpclk,
-      cap_size => cap_size,
-      cap_test => cap_test,
-      RxRec    => RxRec
+      rst_n     => axi_rst_n,
+      tpclk     => tpclk,
+      cap_size  => cap_size,
+      cap_chunk => cap_chunk,
+      cap_test  => cap_test,
+      cap_dense => cap_dense,
+      RxRec     => RxRec
     ) ;
 
 end architecture sim;
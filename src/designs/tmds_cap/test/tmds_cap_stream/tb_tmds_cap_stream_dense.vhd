@@ -0,0 +1,100 @@
+architecture tb_tmds_cap_stream_dense of TestCtrl is
+
+  constant TestName : string := "tb_tmds_cap_stream_dense";
+
+  constant TxPixels : integer := 96;
+  constant TxChunk  : integer := 64; -- 2 x 32, last chunk is short
+  constant TxParam  : std_logic_vector(PARAM_WIDTH-1 downto 0) := (0 => '1', others => '0');
+
+  signal TestDone   : integer_barrier := 1;
+
+begin
+
+  cap_test  <= '0';
+  cap_chunk <= std_logic_vector(to_unsigned(TxChunk,cap_chunk'length));
+  cap_dense <= '1';             -- 32 pixels per 15 words
+
+  ControlProc: process
+  begin
+    SetTestName(TestName);
+    SetLogEnable(PASSED, TRUE);
+    SetLogEnable(INFO,   TRUE);
+    wait for 0 ns;  wait for 0 ns;
+    TranscriptOpen(OSVVM_RESULTS_DIR & TestName & ".txt");
+    SetTranscriptMirror(TRUE);
+    wait until rst_n = '1';
+    ClearAlerts;
+    WaitForBarrier(TestDone, 1 ms);
+    AlertIf(now >= 1 ms, "Test finished due to timeout");
+    AlertIf(GetAffirmCount < 1, "Test is not Self-Checking");
+    TranscriptClose;
+    EndOfTestReports;
+    std.env.stop;
+    wait;
+  end process ControlProc;
+
+  tpclk <= 10 ns; -- 100 MHz (same as AXI)
+  cap_size <= std_logic_vector(to_unsigned(TxPixels,cap_size'length));
+  TxProc: process
+  begin
+    wait;
+  end process TxProc;
+
+  RxProc: process
+    variable RxBurstMode : AddressBusFifoBurstModeType;
+    variable RxParam     : std_logic_vector(PARAM_WIDTH-1 downto 0);
+    variable RxWords     : integer;
+    variable RxData      : std_logic_vector(DATA_WIDTH+USER_WIDTH-1 downto 0);
+    variable TxData      : std_logic_vector(DATA_WIDTH-1 downto 0);
+    variable TxWords     : integer;
+    variable Pixels      : integer;
+    variable Pixel       : unsigned(29 downto 0);   -- next pixel to pack
+    variable Acc         : std_logic_vector(127 downto 0);
+    variable AccBits     : integer range 0 to 128;
+    constant User        : std_logic_vector(USER_WIDTH-1 downto 0) := (others => '0');
+  begin
+    WaitForClock(RxRec, 2);
+
+    SetBurstMode(RxRec, STREAM_BURST_WORD_PARAM_MODE) ;
+    GetBurstMode(RxRec,RxBurstMode);
+    AffirmIfEqual(RxBurstMode, STREAM_BURST_WORD_PARAM_MODE, "RxBurstMode") ;
+
+    -- one burst (ending with tlast) per chunk, pixels packed LSB first
+    Pixel   := (others => '0');
+    Acc     := (others => '0');
+    AccBits := 0;
+    Pixels  := 0;
+    while Pixels < TxPixels loop
+      TxWords := (15*minimum(TxChunk, TxPixels-Pixels))/32;
+      GetBurst(RxRec, RxWords, RxParam) ;
+      AffirmIfEqual(RxParam, TxParam, "RxParam");
+      AffirmIfEqual(RxWords, TxWords, "RxWords");
+      for i in 0 to TxWords-1 loop
+        while AccBits < DATA_WIDTH loop
+          Acc(AccBits+29 downto AccBits) := std_logic_vector(Pixel);
+          AccBits := AccBits+30;
+          Pixel := Pixel+1;
+        end loop;
+        TxData  := Acc(DATA_WIDTH-1 downto 0);
+        Acc     := std_logic_vector(shift_right(unsigned(Acc), DATA_WIDTH));
+        AccBits := AccBits-DATA_WIDTH;
+        RxData := Pop(RxRec.BurstFifo);
+        AffirmIfEqual(RxData, TxData & User, "RxData");
+      end loop ;
+      Pixels := Pixels+TxChunk;
+    end loop;
+
+    WaitForClock(RxRec, 2);
+    WaitForBarrier(TestDone);
+    wait;
+  end process RxProc;
+
+end architecture tb_tmds_cap_stream_dense;
+
+configuration cfg_tb_tmds_cap_stream_dense of tb_tmds_cap_stream is
+  for sim
+    for CTRL: TestCtrl
+      use entity work.TestCtrl(tb_tmds_cap_stream_dense);
+    end for;
+  end for;
+end cfg_tb_tmds_cap_stream_dense;
@@ -12,7 +12,9 @@ architecture tb_tmds_cap_stream_even of TestCtrl is
 
 begin
 
-  cap_test <= '0';
+  cap_test  <= '0';
+  cap_chunk <= (others => '0'); -- unchunked
+  cap_dense <= '0';             -- sparse
 
   ControlProc: process
   begin
@@ -12,7 +12,9 @@ architecture tb_tmds_cap_stream_test of TestCtrl is
 
 begin
 
-  cap_test <= '1';
+  cap_test  <= '1';
+  cap_chunk <= (others => '0'); -- unchunked
+  cap_dense <= '0';             -- sparse
 
   ControlProc: process
   begin
@@ -0,0 +1,189 @@
+--------------------------------------------------------------------------------
+-- tb_tmds_cap_vtm.vhd                                                        --
+-- Simulation testbench for tmds_cap_vtm.vhd and tmds_cap_crc.vhd.            --
+--------------------------------------------------------------------------------
+-- (C) Copyright 2023 Adam Barnes <ambarnes@gmail.com>                        --
+-- This file is part of The Tyto Project. The Tyto Project is free software:  --
+-- you can redistribute it and/or modify it under the terms of the GNU Lesser --
+-- General Public License as published by the Free Software Foundation,       --
+-- either version 3 of the License, or (at your option) any later version.    --
+-- The Tyto Project is distributed in the hope that it will be useful, but    --
+-- WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY --
+-- or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public     --
+-- License for more details. You should have received a copy of the GNU       --
+-- Lesser General Public License along with The Tyto Project. If not, see     --
+-- https://www.gnu.org/licenses/.                                             --
+--------------------------------------------------------------------------------
+-- A small synthetic HDMI stream (active high syncs, each active line preceded
+-- by an 8 pixel video preamble and a 2 character guard band, all within the
+-- back porch) is decoded, measured and signed as in tmds_cap_io. The
+-- measurements are checked against the timing it was generated with, and the
+-- signature of a field against a CRC-32 computed in software.
+
+library ieee;
+  use ieee.std_logic_1164.all;
+  use ieee.numeric_std.all;
+
+library work;
+  use work.tyto_types_pkg.all;
+  use work.tmds_cap_dec_pkg.all;
+  use work.tmds_cap_vtm_pkg.all;
+  use work.tmds_cap_crc_pkg.all;
+
+entity tb_tmds_cap_vtm is
+end entity tb_tmds_cap_vtm;
+
+architecture sim of tb_tmds_cap_vtm is
+
+  constant H_SYNC   : integer := 6;
+  constant H_BP     : integer := 12; -- includes preamble and guard band
+  constant H_ACTIVE : integer := 16;
+  constant H_FP     : integer := 4;
+  constant H_TOTAL  : integer := H_SYNC+H_BP+H_ACTIVE+H_FP;
+  constant V_SYNC   : integer := 2;
+  constant V_BP     : integer := 3;
+  constant V_ACTIVE : integer := 6;
+  constant V_FP     : integer := 2;
+  constant V_TOTAL  : integer := V_SYNC+V_BP+V_ACTIVE+V_FP;
+
+  constant FRAMES   : integer := 6; -- measurements are valid from the 4th frame start
+
+  -- control characters (C1:C0)
+  constant CTRL : slv10_vector(0 to 3) := ("1101010100", "0010101011", "0101010100", "1010101011");
+
+  -- video leading guard band, and a constant pixel (blue 0x10, green 0xAA, red 0x54)
+  constant VIDEO_GB : slv10_vector(0 to 2) := ("1011001100", "0100110011", "1011001100");
+  constant VIDEO_PX : slv10_vector(0 to 2) := ("0111110000", "1000110011", "0111001100");
+
+  -- signature of a field of VIDEO_PX: zlib.crc32(bytes([0x10,0xAA,0x54]*96)) (96 = H_ACTIVE*V_ACTIVE)
+  constant FIELD_CRC : std_logic_vector(31 downto 0) := x"81811F9A";
+
+  signal rst        : std_logic;
+  signal clk        : std_logic := '0';
+
+  signal tmds       : slv10_vector(0 to 2);
+  signal tmds_d     : slv10_vector(0 to 2);
+  signal dec        : tmds_cap_dec_t;
+  signal vtm        : tmds_cap_vtm_t;
+  signal de         : std_logic;
+  signal px         : slv10_vector(0 to 2);
+  signal fs         : std_logic;
+  signal crc        : std_logic_vector(31 downto 0);
+  signal crc_t      : std_logic;
+
+  procedure check(name : string; value : std_logic_vector; expected : integer) is
+  begin
+    assert to_integer(unsigned(value)) = expected
+      report name & " = " & integer'image(to_integer(unsigned(value))) & " expected " & integer'image(expected)
+      severity failure;
+  end procedure check;
+
+begin
+
+  clk <= not clk after 5 ns;
+
+  -- synthetic source
+
+  process(rst,clk)
+    variable x, y     : integer;
+    variable hs, vs   : integer range 0 to 1;
+    variable act_line : boolean;
+  begin
+    if rst = '1' then
+      x    := 0;
+      y    := 0;
+      tmds <= (others => CTRL(0));
+    elsif rising_edge(clk) then
+      hs := 0;
+      vs := 0;
+      if x < H_SYNC then
+        hs := 1;
+      end if;
+      if y < V_SYNC then
+        vs := 1;
+      end if;
+      act_line := y >= V_SYNC+V_BP and y < V_SYNC+V_BP+V_ACTIVE;
+      tmds <= (CTRL(2*vs+hs), CTRL(0), CTRL(0));
+      if act_line then
+        if x >= H_SYNC+H_BP-10 and x < H_SYNC+H_BP-2 then
+          tmds(1) <= CTRL(1); -- video preamble (CTL0 = 1)
+        elsif x >= H_SYNC+H_BP-2 and x < H_SYNC+H_BP then
+          tmds <= VIDEO_GB;
+        elsif x >= H_SYNC+H_BP and x < H_SYNC+H_BP+H_ACTIVE then
+          tmds <= VIDEO_PX;
+        end if;
+      end if;
+      x := x+1;
+      if x = H_TOTAL then
+        x := 0;
+        y := (y+1) mod V_TOTAL;
+      end if;
+    end if;
+  end process;
+
+  -- test
+
+  process
+  begin
+    rst <= '1';
+    wait for 100 ns;
+    wait until rising_edge(clk);
+    rst <= '0';
+    for i in 1 to FRAMES*V_TOTAL*H_TOTAL loop
+      wait until rising_edge(clk);
+    end loop;
+    assert vtm.hvalid = '1' report "hvalid = 0" severity failure;
+    assert vtm.vvalid = '1' report "vvalid = 0" severity failure;
+    assert vtm.interlace = '0' report "interlace = 1" severity failure;
+    assert vtm.hpol = '1' report "hpol = 0" severity failure;
+    assert vtm.vpol = '1' report "vpol = 0" severity failure;
+    check("h_total",  vtm.h_total,  H_TOTAL);
+    check("h_active", vtm.h_active, H_ACTIVE);
+    check("h_fp",     vtm.h_fp,     H_FP);
+    check("h_sync",   vtm.h_sync,   H_SYNC);
+    check("h_bp",     vtm.h_bp,     H_BP);
+    check("v_total",  vtm.v_total,  V_TOTAL);
+    check("v_active", vtm.v_active, V_ACTIVE);
+    check("v_fp",     vtm.v_fp,     V_FP);
+    check("v_sync",   vtm.v_sync,   V_SYNC);
+    check("v_bp",     vtm.v_bp,     V_BP);
+    check("f_total",  vtm.f_total,  V_TOTAL*H_TOTAL);
+    assert crc = FIELD_CRC report "crc = " & to_hstring(crc) & " expected " & to_hstring(FIELD_CRC) severity failure;
+    report "SUCCESS!";
+    std.env.finish;
+  end process;
+
+  U_DEC: component tmds_cap_dec
+    port map (
+      rst    => rst,
+      clk    => clk,
+      tmds_i => tmds,
+      tmds_o => tmds_d,
+      dec    => dec
+    );
+
+  DUT: component tmds_cap_vtm
+    port map (
+      rst  => rst,
+      clk  => clk,
+      lock => '1',
+      tmds => tmds_d,
+      dec  => dec,
+      vtm  => vtm,
+      de   => de,
+      px   => px,
+      fs   => fs
+    );
+
+  U_CRC: component tmds_cap_crc
+    port map (
+      rst   => rst,
+      clk   => clk,
+      de    => de,
+      px    => px,
+      fs    => fs,
+      crc   => crc,
+      crc_t => crc_t
+    );
+
+end architecture sim;
@@ -0,0 +1,129 @@
+--------------------------------------------------------------------------------
+-- tmds_cap_crc.vhd                                                           --
+-- Per frame video signature generator for tmds_cap design.                   --
+--------------------------------------------------------------------------------
+-- (C) Copyright 2023 Adam Barnes <ambarnes@gmail.com>                        --
+-- This file is part of The Tyto Project. The Tyto Project is free software:  --
+-- you can redistribute it and/or modify it under the terms of the GNU Lesser --
+-- General Public License as published by the Free Software Foundation,       --
+-- either version 3 of the License, or (at your option) any later version.    --
+-- The Tyto Project is distributed in the hope that it will be useful, but    --
+-- WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY --
+-- or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public     --
+-- License for more details. You should have received a copy of the GNU       --
+-- Lesser General Public License along with The Tyto Project. If not, see     --
+-- https://www.gnu.org/licenses/.                                             --
+--------------------------------------------------------------------------------
+
+library ieee;
+  use ieee.std_logic_1164.all;
+
+library work;
+  use work.tyto_types_pkg.all;
+
+package tmds_cap_crc_pkg is
+
+  component tmds_cap_crc is
+    port (
+      rst       : in    std_logic;
+      clk       : in    std_logic;
+      de        : in    std_logic;
+      px        : in    slv10_vector(0 to 2);
+      fs        : in    std_logic;
+      crc       : out   std_logic_vector(31 downto 0);
+      crc_t     : out   std_logic
+    );
+  end component tmds_cap_crc;
+
+end package tmds_cap_crc_pkg;
+
+--------------------------------------------------------------------------------
+-- Computes a CRC-32 (as used by Ethernet: reflected, initial value and final
+-- XOR all ones) over the 8b/10b decoded active video pixels of each field,
+-- 24 bits per pixel: channel 0 (blue) bits 7..0, channel 1 (green) bits
+-- 15..8, channel 2 (red) bits 23..16, LSB first. At each field start the
+-- result for the previous field is output on crc and crc_t is toggled, so
+-- that crc is stable for a whole field after each toggle.
+
+library ieee;
+  use ieee.std_logic_1164.all;
+
+library work;
+  use work.tyto_types_pkg.all;
+  use work.tmds_cap_crc_pkg.all;
+
+entity tmds_cap_crc is
+  port (
+    rst       : in    std_logic;                     -- reset
+    clk       : in    std_logic;                     -- pixel clock
+    de        : in    std_logic;                     -- px is active video
+    px        : in    slv10_vector(0 to 2);          -- TMDS characters
+    fs        : in    std_logic;                     -- field start
+    crc       : out   std_logic_vector(31 downto 0); -- signature of last field
+    crc_t     : out   std_logic                      -- toggles when crc is updated
+  );
+end entity tmds_cap_crc;
+
+architecture synth of tmds_cap_crc is
+
+  constant POLY     : std_logic_vector(31 downto 0) := x"EDB88320"; -- reflected 0x04C11DB7
+
+  signal de_1       : std_logic;                          -- stage 1: active video
+  signal d          : std_logic_vector(23 downto 0);      -- stage 1: decoded pixel
+  signal fs_1       : std_logic;                          -- stage 1: field start
+  signal acc        : std_logic_vector(31 downto 0);      -- CRC accumulator
+
+  -- TMDS video (8b/10b) decode
+  function tmds_decode(q : std_logic_vector(9 downto 0)) return std_logic_vector is
+    variable b : std_logic_vector(7 downto 0);
+    variable r : std_logic_vector(7 downto 0);
+  begin
+    b := not q(7 downto 0) when q(9) = '1' else q(7 downto 0);
+    r(0) := b(0);
+    for i in 1 to 7 loop
+      r(i) := b(i) xor b(i-1) xor not q(8);
+    end loop;
+    return r;
+  end function tmds_decode;
+
+  -- CRC-32, 24 bits per clock
+  function crc32_24(q : std_logic_vector(31 downto 0); d : std_logic_vector(23 downto 0)) return std_logic_vector is
+    variable r : std_logic_vector(31 downto 0);
+  begin
+    r := q;
+    for i in 0 to 23 loop
+      if (r(0) xor d(i)) = '1' then
+        r := ('0' & r(31 downto 1)) xor POLY;
+      else
+        r := '0' & r(31 downto 1);
+      end if;
+    end loop;
+    return r;
+  end function crc32_24;
+
+begin
+
+  process(rst,clk)
+  begin
+    if rst = '1' then
+      de_1  <= '0';
+      d     <= (others => '0');
+      fs_1  <= '0';
+      acc   <= (others => '1');
+      crc   <= (others => '0');
+      crc_t <= '0';
+    elsif rising_edge(clk) then
+      de_1 <= de;
+      d    <= tmds_decode(px(2)) & tmds_decode(px(1)) & tmds_decode(px(0));
+      fs_1 <= fs;
+      if fs_1 = '1' then
+        crc   <= not acc;
+        crc_t <= not crc_t;
+        acc   <= crc32_24(x"FFFFFFFF", d) when de_1 = '1' else x"FFFFFFFF";
+      elsif de_1 = '1' then
+        acc <= crc32_24(acc, d);
+      end if;
+    end if;
+  end process;
+
+end architecture synth;
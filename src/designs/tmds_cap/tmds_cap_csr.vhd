@@ -21,6 +21,7 @@ library ieee;
 library work;
   use work.axi4_pkg.all;
   use work.hdmi_rx_selectio_pkg.all;
+  use work.tmds_cap_vtm_pkg.all;
 
 package tmds_cap_csr_pkg is
 
@@ -39,14 +40,33 @@ package tmds_cap_csr_pkg is
 
       cap_rst        : out   std_logic;
       cap_size       : out   std_logic_vector(31 downto 0);
+      cap_chunk      : out   std_logic_vector(31 downto 0);
       cap_en         : out   std_logic;
       cap_test       : out   std_logic;
+      cap_dense      : out   std_logic;
+      cap_pkt        : out   std_logic;
+      trig_mode      : out   std_logic_vector(1 downto 0);
+      trig_vpol      : out   std_logic;
+      trig_pre       : out   std_logic_vector(31 downto 0);
+      trig_hdr       : out   std_logic_vector(23 downto 0);
+      trig_mask      : out   std_logic_vector(23 downto 0);
+      win_en         : out   std_logic;
+      win_hpol       : out   std_logic;
+      win_vpol       : out   std_logic;
+      win_line       : out   std_logic_vector(31 downto 0);
+      win_pix        : out   std_logic_vector(31 downto 0);
+      win_skip       : out   std_logic_vector(31 downto 0);
+      cap_arm        : in    std_logic;
       cap_run        : in    std_logic;
       cap_stop       : in    std_logic;
       cap_loss       : in    std_logic;
       cap_ovf        : in    std_logic;
       cap_unf        : in    std_logic;
-      cap_count      : in    std_logic_vector(31 downto 0)
+      cap_count      : in    std_logic_vector(31 downto 0);
+      cap_irq        : out   std_logic;
+      vtm            : in    tmds_cap_vtm_t;
+      crc            : in    std_logic_vector(31 downto 0);
+      crc_t          : in    std_logic
 
     );
   end component tmds_cap_csr;
@@ -57,12 +77,14 @@ end package tmds_cap_csr_pkg;
 
 library ieee;
   use ieee.std_logic_1164.all;
+  use ieee.numeric_std.all;
 
 library work;
   use work.tyto_types_pkg.all;
   use work.axi4_pkg.all;
   use work.axi4_a32d32_srw32_pkg.all;
   use work.hdmi_rx_selectio_pkg.all;
+  use work.tmds_cap_vtm_pkg.all;
   use work.tmds_cap_csr_ra_pkg.all;
 
 entity tmds_cap_csr is
@@ -80,20 +102,41 @@ entity tmds_cap_csr is
 
     cap_rst        : out   std_logic;                                          -- capture reset
     cap_size       : out   std_logic_vector(31 downto 0);                      -- capture size (pixels)
+    cap_chunk      : out   std_logic_vector(31 downto 0);                      -- capture chunk size (pixels)
     cap_en         : out   std_logic;                                          -- capture enable
     cap_test       : out   std_logic;                                          -- capture test
+    cap_dense      : out   std_logic;                                          -- capture dense (30 bit) packing
+    cap_pkt        : out   std_logic;                                          -- capture data island packets
+    trig_mode      : out   std_logic_vector(1 downto 0);                       -- trigger mode
+    trig_vpol      : out   std_logic;                                          -- trigger VSYNC edge (0 = rising, 1 = falling)
+    trig_pre       : out   std_logic_vector(31 downto 0);                      -- pre-trigger depth (pixels)
+    trig_hdr       : out   std_logic_vector(23 downto 0);                      -- trigger packet header value
+    trig_mask      : out   std_logic_vector(23 downto 0);                      -- trigger packet header mask
+    win_en         : out   std_logic;                                          -- window enable
+    win_hpol       : out   std_logic;                                          -- window HSYNC polarity (1 = active low)
+    win_vpol       : out   std_logic;                                          -- window VSYNC polarity (1 = active low)
+    win_line       : out   std_logic_vector(31 downto 0);                      -- window lines (count:first)
+    win_pix        : out   std_logic_vector(31 downto 0);                      -- window pixels (count:first)
+    win_skip       : out   std_logic_vector(31 downto 0);                      -- window frames skipped between captured frames
+    cap_arm        : in    std_logic;                                          -- capture armed (waiting for trigger)
     cap_run        : in    std_logic;                                          -- capture running
     cap_stop       : in    std_logic;                                          -- capture stopped
     cap_loss       : in    std_logic;                                          -- capture loss of TMDS lock
     cap_ovf        : in    std_logic;                                          -- capture FIFO overflow
     cap_unf        : in    std_logic;                                          -- capture FIFO underflow
-    cap_count      : in    std_logic_vector(31 downto 0)                       -- capture count (pixels)
+    cap_count      : in    std_logic_vector(31 downto 0);                      -- capture count (pixels)
+    cap_irq        : out   std_logic;                                          -- capture interrupt request (stop or overflow)
+    vtm            : in    tmds_cap_vtm_t;                                     -- video timing measurements
+    crc            : in    std_logic_vector(31 downto 0);                      -- video signature of last field
+    crc_t          : in    std_logic                                           -- video signature toggle
 
   );
 end entity tmds_cap_csr;
 
 architecture synth of tmds_cap_csr is
 
+  type crc_ring_t is array(0 to 15) of std_logic_vector(31 downto 0);
+
   signal sw_en   : std_logic;
   signal sw_addr : std_logic_vector(31 downto 0);
   signal sw_be   : std_logic_vector(3 downto 0);
@@ -107,6 +150,15 @@ architecture synth of tmds_cap_csr is
   signal tmds_status_s1 : hdmi_rx_selectio_status_t;      -- tmds_status synchroniser registers (first level)
   signal tmds_status_s2 : hdmi_rx_selectio_status_t;      -- tmds_status synchroniser registers (second level)
   alias  s : hdmi_rx_selectio_status_t is tmds_status_s2;
+  signal vtm_s1         : tmds_cap_vtm_t;                 -- vtm synchroniser registers (first level)
+  signal vtm_s2         : tmds_cap_vtm_t;                 -- vtm synchroniser registers (second level)
+  alias  v : tmds_cap_vtm_t is vtm_s2;
+  signal cap_irq_s1     : std_logic;                      -- capture interrupt synchroniser registers
+  signal cap_irq_s2     : std_logic;
+  signal cap_ie         : std_logic;                      -- capture interrupt enable
+  signal crc_t_s        : std_logic_vector(1 to 3);       -- crc_t synchroniser registers (and edge detect)
+  signal crc_count      : unsigned(31 downto 0);          -- video signature count
+  signal crc_ring       : crc_ring_t;                     -- video signature ring
 
   signal atap    : std_logic_vector(31 downto 0);
   signal bitslip : std_logic_vector(31 downto 0);
@@ -117,6 +169,11 @@ architecture synth of tmds_cap_csr is
   attribute async_reg : string;
   attribute async_reg of tmds_status_s1 : signal is "TRUE";
   attribute async_reg of tmds_status_s2 : signal is "TRUE";
+  attribute async_reg of vtm_s1         : signal is "TRUE";
+  attribute async_reg of vtm_s2         : signal is "TRUE";
+  attribute async_reg of cap_irq_s1     : signal is "TRUE";
+  attribute async_reg of cap_irq_s2     : signal is "TRUE";
+  attribute async_reg of crc_t_s        : signal is "TRUE";
 
 begin
 
@@ -144,9 +201,31 @@ begin
     if rising_edge(axi_clk) then
       tmds_status_s1 <= tmds_status;
       tmds_status_s2 <= tmds_status_s1;
+      vtm_s1         <= vtm;
+      vtm_s2         <= vtm_s1;
+      cap_irq_s1     <= cap_stop or cap_ovf;
+      cap_irq_s2     <= cap_irq_s1;
+      crc_t_s        <= crc_t & crc_t_s(1 to 2);
+    end if;
+  end process;
+
+  -- video signatures: crc is stable for a field after crc_t toggles
+  process(axi_rst_n,axi_clk)
+  begin
+    if axi_rst_n = '0' then
+      crc_count <= (others => '0');
+      crc_ring  <= (others => (others => '0'));
+    elsif rising_edge(axi_clk) then
+      if crc_t_s(2) /= crc_t_s(3) then
+        crc_ring(to_integer(crc_count(3 downto 0))) <= crc;
+        crc_count <= crc_count+1;
+      end if;
     end if;
   end process;
 
+  -- level sensitive: software clears CAPCTRL.IE to acknowledge
+  cap_irq <= cap_ie and cap_irq_s2;
+
   -- register read/write
 
   sw_rdy <= '1';
@@ -155,26 +234,84 @@ begin
   begin
     if axi_rst_n = '0' then
 
-      cap_rst  <= '1';
-      cap_en   <= '0';
-      cap_size <= (others => '0');
-      scratch  <= (others => '0');
-      sr_data  <= (others => '0');
+      cap_rst   <= '1';
+      cap_en    <= '0';
+      cap_ie    <= '0';
+      cap_dense <= '0';
+      cap_pkt   <= '0';
+      cap_size  <= (others => '0');
+      cap_chunk <= (others => '0');
+      trig_mode <= (others => '0');
+      trig_vpol <= '0';
+      trig_pre  <= (others => '0');
+      trig_hdr  <= (others => '0');
+      trig_mask <= (others => '0');
+      win_en    <= '0';
+      win_hpol  <= '0';
+      win_vpol  <= '0';
+      win_line  <= (others => '0');
+      win_pix   <= (others => '0');
+      win_skip  <= (others => '0');
+      scratch   <= (others => '0');
+      sr_data   <= (others => '0');
 
     elsif rising_edge(axi_clk) then
 
       -- write
       if sw_en = '1' then
-        case sw_addr(7 downto 0) is
+        case sw_addr(11 downto 0) is
           when RA_CAPCTRL =>
-            cap_en   <= sw_data(0)  when sw_be(0) = '1';
-            cap_test <= sw_data(1)  when sw_be(0) = '1';
-            cap_rst  <= sw_data(31) when sw_be(3) = '1';
+            cap_en    <= sw_data(0)  when sw_be(0) = '1';
+            cap_test  <= sw_data(1)  when sw_be(0) = '1';
+            cap_ie    <= sw_data(2)  when sw_be(0) = '1';
+            cap_dense <= sw_data(3)  when sw_be(0) = '1';
+            cap_pkt   <= sw_data(4)  when sw_be(0) = '1';
+            cap_rst   <= sw_data(31) when sw_be(3) = '1';
           when RA_CAPSIZE =>
             cap_size(  7 downto  0 ) <= sw_data(  7 downto  0 ) when sw_be(0) = '1';
             cap_size( 15 downto  8 ) <= sw_data( 15 downto  8 ) when sw_be(1) = '1';
             cap_size( 23 downto 16 ) <= sw_data( 23 downto 16 ) when sw_be(2) = '1';
             cap_size( 31 downto 24 ) <= sw_data( 31 downto 24 ) when sw_be(3) = '1';
+          when RA_CAPCHUNK =>
+            cap_chunk(  7 downto  0 ) <= sw_data(  7 downto  0 ) when sw_be(0) = '1';
+            cap_chunk( 15 downto  8 ) <= sw_data( 15 downto  8 ) when sw_be(1) = '1';
+            cap_chunk( 23 downto 16 ) <= sw_data( 23 downto 16 ) when sw_be(2) = '1';
+            cap_chunk( 31 downto 24 ) <= sw_data( 31 downto 24 ) when sw_be(3) = '1';
+          when RA_TRIGCTRL =>
+            trig_mode <= sw_data(1 downto 0) when sw_be(0) = '1';
+            trig_vpol <= sw_data(4)          when sw_be(0) = '1';
+          when RA_TRIGPRE =>
+            trig_pre(  7 downto  0 ) <= sw_data(  7 downto  0 ) when sw_be(0) = '1';
+            trig_pre( 15 downto  8 ) <= sw_data( 15 downto  8 ) when sw_be(1) = '1';
+            trig_pre( 23 downto 16 ) <= sw_data( 23 downto 16 ) when sw_be(2) = '1';
+            trig_pre( 31 downto 24 ) <= sw_data( 31 downto 24 ) when sw_be(3) = '1';
+          when RA_TRIGHDR =>
+            trig_hdr(  7 downto  0 ) <= sw_data(  7 downto  0 ) when sw_be(0) = '1';
+            trig_hdr( 15 downto  8 ) <= sw_data( 15 downto  8 ) when sw_be(1) = '1';
+            trig_hdr( 23 downto 16 ) <= sw_data( 23 downto 16 ) when sw_be(2) = '1';
+          when RA_TRIGMASK =>
+            trig_mask(  7 downto  0 ) <= sw_data(  7 downto  0 ) when sw_be(0) = '1';
+            trig_mask( 15 downto  8 ) <= sw_data( 15 downto  8 ) when sw_be(1) = '1';
+            trig_mask( 23 downto 16 ) <= sw_data( 23 downto 16 ) when sw_be(2) = '1';
+          when RA_WINCTRL =>
+            win_en   <= sw_data(0) when sw_be(0) = '1';
+            win_hpol <= sw_data(4) when sw_be(0) = '1';
+            win_vpol <= sw_data(5) when sw_be(0) = '1';
+          when RA_WINLINE =>
+            win_line(  7 downto  0 ) <= sw_data(  7 downto  0 ) when sw_be(0) = '1';
+            win_line( 15 downto  8 ) <= sw_data( 15 downto  8 ) when sw_be(1) = '1';
+            win_line( 23 downto 16 ) <= sw_data( 23 downto 16 ) when sw_be(2) = '1';
+            win_line( 31 downto 24 ) <= sw_data( 31 downto 24 ) when sw_be(3) = '1';
+          when RA_WINPIX =>
+            win_pix(  7 downto  0 ) <= sw_data(  7 downto  0 ) when sw_be(0) = '1';
+            win_pix( 15 downto  8 ) <= sw_data( 15 downto  8 ) when sw_be(1) = '1';
+            win_pix( 23 downto 16 ) <= sw_data( 23 downto 16 ) when sw_be(2) = '1';
+            win_pix( 31 downto 24 ) <= sw_data( 31 downto 24 ) when sw_be(3) = '1';
+          when RA_WINSKIP =>
+            win_skip(  7 downto  0 ) <= sw_data(  7 downto  0 ) when sw_be(0) = '1';
+            win_skip( 15 downto  8 ) <= sw_data( 15 downto  8 ) when sw_be(1) = '1';
+            win_skip( 23 downto 16 ) <= sw_data( 23 downto 16 ) when sw_be(2) = '1';
+            win_skip( 31 downto 24 ) <= sw_data( 31 downto 24 ) when sw_be(3) = '1';
           when RA_GPO =>
             gpo(  7 downto  0 ) <= sw_data(  7 downto  0 ) when sw_be(0) = '1';
             gpo( 15 downto  8 ) <= sw_data( 15 downto  8 ) when sw_be(1) = '1';
@@ -203,11 +340,11 @@ begin
       capstat <=
         x"000000" & '0' &
         cap_unf & cap_ovf & cap_loss &
-        "00" & cap_stop & cap_run;
+        '0' & cap_arm & cap_stop & cap_run;
 
       if sr_en = '1' and sr_rdy = '0' then
         sr_rdy <= '1';
-        with sr_addr(7 downto 0) select sr_data <=
+        with sr_addr(11 downto 0) select sr_data <=
           x"53444D54"                                  when RA_SIGNATURE,
           s.count_freq                                 when RA_FREQ,
           astat                                        when RA_ASTAT,
@@ -230,14 +367,36 @@ begin
           s.count_aloss_s(1)                           when RA_ALOSS1,
           s.count_aloss_s(2)                           when RA_ALOSS2,
           s.count_aloss_p                              when RA_ALOSSP,
-          cap_rst & "000" & x"000000" & "000" & cap_en when RA_CAPCTRL,
+          cap_rst & "000" & x"00000" & "000" & cap_pkt & cap_dense & cap_ie & '0' & cap_en when RA_CAPCTRL,
           cap_size                                     when RA_CAPSIZE,
           capstat                                      when RA_CAPSTAT,
           cap_count                                    when RA_CAPCOUNT,
+          cap_chunk                                    when RA_CAPCHUNK,
+          x"000000" & "000" & trig_vpol & "00" & trig_mode when RA_TRIGCTRL,
+          trig_pre                                     when RA_TRIGPRE,
+          x"00" & trig_hdr                             when RA_TRIGHDR,
+          x"00" & trig_mask                            when RA_TRIGMASK,
+          x"000000" & "00" & win_vpol & win_hpol & "000" & win_en when RA_WINCTRL,
+          win_line                                     when RA_WINLINE,
+          win_pix                                      when RA_WINPIX,
+          win_skip                                     when RA_WINSKIP,
+          x"000000" & "00" & v.vpol & v.hpol & '0' & v.interlace & v.vvalid & v.hvalid when RA_VTMSTAT,
+          v.h_active & v.h_total                       when RA_VTMH0,
+          v.h_sync & v.h_fp                            when RA_VTMH1,
+          x"0000" & v.h_bp                             when RA_VTMH2,
+          v.v_active & v.v_total                       when RA_VTMV0,
+          v.v_sync & v.v_fp                            when RA_VTMV1,
+          x"0000" & v.v_bp                             when RA_VTMV2,
+          v.f_total                                    when RA_VTMF,
+          std_logic_vector(crc_count)                  when RA_CRCCOUNT,
+          crc_ring(to_integer(crc_count(3 downto 0)-1)) when RA_CRCLAST,
           gpi                                          when RA_GPI,
           gpo                                          when RA_GPO,
           scratch                                      when RA_SCRATCH,
           (others => '0')                              when others;
+        if sr_addr(11 downto 6) = RA_CRCRING(11 downto 6) then
+          sr_data <= crc_ring(to_integer(unsigned(sr_addr(5 downto 2))));
+        end if;
       else
         sr_rdy  <= '0';
         sr_data <= (others => '0');
@@ -0,0 +1,255 @@
+--------------------------------------------------------------------------------
+-- tmds_cap_dec.vhd                                                           --
+-- TMDS stream decoder (front end) for tmds_cap design.                       --
+--------------------------------------------------------------------------------
+-- (C) Copyright 2023 Adam Barnes <ambarnes@gmail.com>                        --
+-- This file is part of The Tyto Project. The Tyto Project is free software:  --
+-- you can redistribute it and/or modify it under the terms of the GNU Lesser --
+-- General Public License as published by the Free Software Foundation,       --
+-- either version 3 of the License, or (at your option) any later version.    --
+-- The Tyto Project is distributed in the hope that it will be useful, but    --
+-- WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY --
+-- or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public     --
+-- License for more details. You should have received a copy of the GNU       --
+-- Lesser General Public License along with The Tyto Project. If not, see     --
+-- https://www.gnu.org/licenses/.                                             --
+--------------------------------------------------------------------------------
+
+library ieee;
+  use ieee.std_logic_1164.all;
+
+library work;
+  use work.tyto_types_pkg.all;
+
+package tmds_cap_dec_pkg is
+
+  type tmds_cap_dec_t is record
+    video  : std_logic;                    -- active video (guard band excluded)
+    pre_di : std_logic;                    -- last (8th) pixel of a data island preamble
+    island : std_logic;                    -- data island packet pixel (guard bands excluded)
+    pk_i   : std_logic_vector(4 downto 0); -- pixel index within packet (island only)
+    d      : slv4_vector(0 to 2);          -- TERC4 data bits (island only)
+    hs     : std_logic;                    -- HSYNC as sent
+    vs     : std_logic;                    -- VSYNC as sent
+  end record tmds_cap_dec_t;
+
+  constant TMDS_CAP_DEC_BITS : integer := 22; -- bits in tmds_cap_dec_t
+
+  component tmds_cap_dec is
+    port (
+      rst       : in    std_logic;
+      clk       : in    std_logic;
+      tmds_i    : in    slv10_vector(0 to 2);
+      tmds_o    : out   slv10_vector(0 to 2);
+      dec       : out   tmds_cap_dec_t
+    );
+  end component tmds_cap_dec;
+
+end package tmds_cap_dec_pkg;
+
+--------------------------------------------------------------------------------
+-- Classifies the characters of the TMDS stream, and tracks the periods they
+-- belong to (control, video preamble and guard band, video, data island
+-- preamble and guard bands, data island packets). Outputs are 3 clocks
+-- behind tmds_i, aligned with the copy of the characters on tmds_o.
+-- Syncs are taken from channel 0: control characters, or TERC4 characters
+-- (D1:D0) within data island periods, from the leading guard band to the
+-- trailing one. A data island period must begin with a whole (8 pixel)
+-- preamble and a guard band; TERC4 characters are also valid video
+-- characters, so those outside a recognised data island are ignored and the
+-- syncs hold their last values. Video with no preamble (DVI) is active from
+-- its first character.
+
+library ieee;
+  use ieee.std_logic_1164.all;
+  use ieee.numeric_std.all;
+
+library work;
+  use work.tyto_types_pkg.all;
+  use work.tmds_cap_dec_pkg.all;
+
+entity tmds_cap_dec is
+  port (
+    rst       : in    std_logic;                     -- reset
+    clk       : in    std_logic;                     -- pixel clock
+    tmds_i    : in    slv10_vector(0 to 2);          -- TMDS characters in
+    tmds_o    : out   slv10_vector(0 to 2);          -- TMDS characters out (delayed)
+    dec       : out   tmds_cap_dec_t                 -- decoded (for tmds_o)
+  );
+end entity tmds_cap_dec;
+
+architecture synth of tmds_cap_dec is
+
+  constant DATA_GB  : std_logic_vector(9 downto 0) := "0100110011";
+
+  type period_t is (
+    CTRL,      -- control
+    VIDEO_GB1, -- video leading guard band, 1st character
+    VIDEO_GB2, -- video leading guard band, 2nd character
+    VIDEO,     -- active video
+    DATA_GB,   -- data island leading guard band
+    ISLAND,    -- data island packets
+    DATA_END,  -- data island trailing guard band
+    OTHER      -- unrecognised (e.g. incomplete preamble)
+  );
+
+  signal t1         : slv10_vector(0 to 2);               -- stage 1: characters
+  signal t2         : slv10_vector(0 to 2);               -- stage 2: characters
+  signal ctrl       : std_logic_vector(0 to 2);           -- stage 2: control character
+  signal c          : slv2_vector(0 to 2);                -- stage 2: control bits
+  signal terc4      : std_logic_vector(0 to 2);           -- stage 2: TERC4 character
+  signal d          : slv4_vector(0 to 2);                -- stage 2: TERC4 data bits
+  signal gb         : std_logic;                          -- stage 2: data guard band (channels 1 and 2)
+
+  signal pre_n      : integer range 0 to 8;               -- preamble pixels so far
+  signal pre_d      : std_logic;                          -- preamble is for a data island (else video)
+  signal period     : period_t;                           -- period of last pixel
+  signal pk_i       : integer range 0 to 31;              -- pixel index within packet
+
+begin
+
+  -- classify characters
+
+  process(rst,clk)
+  begin
+    if rst = '1' then
+      t1     <= (others => (others => '0'));
+      t2     <= (others => (others => '0'));
+      ctrl   <= (others => '0');
+      c      <= (others => (others => '0'));
+      terc4  <= (others => '0');
+      d      <= (others => (others => '0'));
+      gb     <= '0';
+    elsif rising_edge(clk) then
+      t1     <= tmds_i;
+      t2     <= t1;
+      for i in 0 to 2 loop
+        ctrl(i)  <= '1';
+        terc4(i) <= '1';
+        c(i)     <= "00";
+        d(i)     <= "0000";
+        case t1(i) is
+          when "1101010100" => c(i) <= "00"; terc4(i) <= '0';
+          when "0010101011" => c(i) <= "01"; terc4(i) <= '0';
+          when "0101010100" => c(i) <= "10"; terc4(i) <= '0';
+          when "1010101011" => c(i) <= "11"; terc4(i) <= '0';
+          when "1010011100" => d(i) <= "0000"; ctrl(i) <= '0';
+          when "1001100011" => d(i) <= "0001"; ctrl(i) <= '0';
+          when "1011100100" => d(i) <= "0010"; ctrl(i) <= '0';
+          when "1011100010" => d(i) <= "0011"; ctrl(i) <= '0';
+          when "0101110001" => d(i) <= "0100"; ctrl(i) <= '0';
+          when "0100011110" => d(i) <= "0101"; ctrl(i) <= '0';
+          when "0110001110" => d(i) <= "0110"; ctrl(i) <= '0';
+          when "0100111100" => d(i) <= "0111"; ctrl(i) <= '0';
+          when "1011001100" => d(i) <= "1000"; ctrl(i) <= '0';
+          when "0100111001" => d(i) <= "1001"; ctrl(i) <= '0';
+          when "0110011100" => d(i) <= "1010"; ctrl(i) <= '0';
+          when "1011000110" => d(i) <= "1011"; ctrl(i) <= '0';
+          when "1010001110" => d(i) <= "1100"; ctrl(i) <= '0';
+          when "1001110001" => d(i) <= "1101"; ctrl(i) <= '0';
+          when "0101100011" => d(i) <= "1110"; ctrl(i) <= '0';
+          when "1011000011" => d(i) <= "1111"; ctrl(i) <= '0';
+          when others       => ctrl(i) <= '0'; terc4(i) <= '0';
+        end case;
+      end loop;
+      gb <= '1' when t1(1) = DATA_GB and t1(2) = DATA_GB else '0';
+    end if;
+  end process;
+
+  -- track periods, extract syncs
+
+  process(rst,clk)
+    variable p : period_t;              -- period of this pixel
+    variable i : integer range 0 to 31; -- its index within a packet
+  begin
+    if rst = '1' then
+      pre_n      <= 0;
+      pre_d      <= '0';
+      period     <= CTRL;
+      pk_i       <= 0;
+      tmds_o     <= (others => (others => '0'));
+      dec.video  <= '0';
+      dec.pre_di <= '0';
+      dec.island <= '0';
+      dec.pk_i   <= (others => '0');
+      dec.d      <= (others => (others => '0'));
+      dec.hs     <= '0';
+      dec.vs     <= '0';
+    elsif rising_edge(clk) then
+      tmds_o     <= t2;
+      dec.pre_di <= '0';
+      dec.d      <= d;
+
+      -- preambles: CTL0..3 = 1000 (video) or 1010 (data island), 8 pixels
+      if ctrl = "111" and c(1) = "01" and c(2)(1) = '0' then
+        if pre_n = 0 or pre_d /= c(2)(0) then
+          pre_n <= 1;
+        elsif pre_n < 8 then
+          pre_n <= pre_n+1;
+          if pre_n = 7 and c(2)(0) = '1' then
+            dec.pre_di <= '1';
+          end if;
+        end if;
+        pre_d <= c(2)(0);
+      else
+        pre_n <= 0;
+      end if;
+
+      -- periods (the preamble, if any, ended with the last pixel)
+      p := period;
+      i := 0;
+      if ctrl(0) = '1' then
+        p := CTRL;
+      else
+        case period is
+          when CTRL =>
+            if pre_n = 0 then
+              p := VIDEO; -- DVI: no preamble or guard band
+            elsif pre_d = '0' then
+              p := VIDEO_GB1;
+            elsif pre_n = 8 and gb = '1' then
+              p := DATA_GB;
+            else
+              p := OTHER;
+            end if;
+          when VIDEO_GB1 =>
+            p := VIDEO_GB2;
+          when VIDEO_GB2 =>
+            p := VIDEO;
+          when DATA_GB =>
+            if gb = '0' and terc4 = "111" then
+              p := ISLAND;
+            elsif gb = '0' then
+              p := OTHER;
+            end if;
+          when ISLAND =>
+            if gb = '1' then
+              p := DATA_END;
+            elsif terc4 /= "111" then
+              p := OTHER; -- error
+            else
+              i := (pk_i+1) mod 32;
+            end if;
+          when others =>
+            null;
+        end case;
+      end if;
+      period     <= p;
+      pk_i       <= i;
+      dec.video  <= '1' when p = VIDEO else '0';
+      dec.island <= '1' when p = ISLAND else '0';
+      dec.pk_i   <= std_logic_vector(to_unsigned(i,5));
+
+      -- syncs: channel 0 C1:C0, or D1:D0 in data island periods
+      if ctrl(0) = '1' then
+        dec.hs <= c(0)(0);
+        dec.vs <= c(0)(1);
+      elsif terc4(0) = '1' and (p = DATA_GB or p = ISLAND or p = DATA_END) then
+        dec.hs <= d(0)(0);
+        dec.vs <= d(0)(1);
+      end if;
+
+    end if;
+  end process;
+
+end architecture synth;
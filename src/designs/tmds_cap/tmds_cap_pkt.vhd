@@ -0,0 +1,207 @@
+--------------------------------------------------------------------------------
+-- tmds_cap_pkt.vhd                                                           --
+-- Data island packet extractor for tmds_cap design.                          --
+--------------------------------------------------------------------------------
+-- (C) Copyright 2023 Adam Barnes <ambarnes@gmail.com>                        --
+-- This file is part of The Tyto Project. The Tyto Project is free software:  --
+-- you can redistribute it and/or modify it under the terms of the GNU Lesser --
+-- General Public License as published by the Free Software Foundation,       --
+-- either version 3 of the License, or (at your option) any later version.    --
+-- The Tyto Project is distributed in the hope that it will be useful, but    --
+-- WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY --
+-- or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public     --
+-- License for more details. You should have received a copy of the GNU       --
+-- Lesser General Public License along with The Tyto Project. If not, see     --
+-- https://www.gnu.org/licenses/.                                             --
+--------------------------------------------------------------------------------
+
+library ieee;
+  use ieee.std_logic_1164.all;
+
+library work;
+  use work.tyto_types_pkg.all;
+  use work.tmds_cap_dec_pkg.all;
+
+package tmds_cap_pkt_pkg is
+
+  constant PKT_WORDS : integer := 5; -- 64 bit words per packet record
+
+  component tmds_cap_pkt is
+    port (
+      rst       : in    std_logic;
+      clk       : in    std_logic;
+      dec       : in    tmds_cap_dec_t;
+      en        : in    std_logic;
+      valid     : out   std_logic;
+      data      : out   std_logic_vector(63 downto 0);
+      last      : out   std_logic
+    );
+  end component tmds_cap_pkt;
+
+end package tmds_cap_pkt_pkg;
+
+--------------------------------------------------------------------------------
+-- Collects data island packets from the decoded TMDS stream (see
+-- tmds_cap_dec.vhd) and checks their BCH ECC. Each packet completed while en
+-- is high is output as a record of PKT_WORDS consecutive 64 bit words, the
+-- last flagged by last:
+--  word 0      : timestamp: pixels since en was asserted, to first packet pixel
+--  words 1..4  : 32 bytes: HB0, HB1, HB2, status, then subpackets 0..3
+--                (bytes 0..6 of each, i.e. PB0..PB27)
+-- Status bit 0 is set if the header ECC is bad, bits 1..4 if the ECC of
+-- subpackets 0..3 is bad. ECC bytes are not included.
+
+library ieee;
+  use ieee.std_logic_1164.all;
+  use ieee.numeric_std.all;
+
+library work;
+  use work.tyto_types_pkg.all;
+  use work.tmds_cap_dec_pkg.all;
+  use work.tmds_cap_pkt_pkg.all;
+
+entity tmds_cap_pkt is
+  port (
+    rst       : in    std_logic;                     -- reset
+    clk       : in    std_logic;                     -- pixel clock
+    dec       : in    tmds_cap_dec_t;                -- decoded TMDS stream
+    en        : in    std_logic;                     -- enable (timestamp counts from rising edge)
+    valid     : out   std_logic;                     -- record word valid
+    data      : out   std_logic_vector(63 downto 0); -- record word
+    last      : out   std_logic                      -- last word of record
+  );
+end entity tmds_cap_pkt;
+
+architecture synth of tmds_cap_pkt is
+
+  type sb_t is array(0 to 3) of std_logic_vector(63 downto 0);
+  type ecc_t is array(0 to 3) of std_logic_vector(7 downto 0);
+  type rec_t is array(0 to PKT_WORDS-1) of std_logic_vector(63 downto 0);
+
+  signal ts         : unsigned(63 downto 0);              -- timestamp
+  signal pk_ts      : std_logic_vector(63 downto 0);      -- timestamp of packet
+  signal hb         : std_logic_vector(31 downto 0);      -- header bits (with ECC)
+  signal sb         : sb_t;                               -- subpacket bits (with ECC)
+  signal ecc_h      : std_logic_vector(7 downto 0);       -- header ECC (calculated)
+  signal ecc_s      : ecc_t;                              -- subpacket ECC (calculated)
+
+  signal rec        : rec_t;                              -- record being output
+  signal rec_n      : integer range 0 to PKT_WORDS;       -- record words left to output
+
+  -- BCH ECC functions (see hdmi_bch_ecc.py)
+  function bch_ecc_1 ( -- 1 bit per clock
+    q : std_logic_vector(7 downto 0);
+    d : std_logic
+  ) return std_logic_vector is
+    variable r : std_logic_vector(7 downto 0);
+  begin
+    r(0) := d xor q(0) xor q(1);
+    r(1) := d xor q(0) xor q(2);
+    r(2) := q(3);
+    r(3) := q(4);
+    r(4) := q(5);
+    r(5) := q(6);
+    r(6) := q(7);
+    r(7) := d xor q(0);
+    return r;
+  end function bch_ecc_1;
+
+  function bch_ecc_2 ( -- 2 bits per clock
+    q : std_logic_vector(7 downto 0);
+    d : std_logic_vector(1 downto 0)
+  ) return std_logic_vector is
+    variable r : std_logic_vector(7 downto 0);
+  begin
+    r(0) := d(1) xor q(1) xor q(2);
+    r(1) := d(0) xor d(1) xor q(0) xor q(1) xor q(3);
+    r(2) := q(4);
+    r(3) := q(5);
+    r(4) := q(6);
+    r(5) := q(7);
+    r(6) := d(0) xor q(0);
+    r(7) := d(0) xor d(1) xor q(0) xor q(1);
+    return r;
+  end function bch_ecc_2;
+
+begin
+
+  -- extract
+
+  process(rst,clk)
+    variable i    : integer range 0 to 31;          -- pixel index within the packet
+    variable h    : std_logic_vector(31 downto 0);
+    variable s    : sb_t;
+    variable st   : std_logic_vector(7 downto 0);   -- status
+    variable r    : std_logic_vector(255 downto 0); -- record bytes
+  begin
+    if rst = '1' then
+      ts      <= (others => '0');
+      pk_ts   <= (others => '0');
+      hb      <= (others => '0');
+      sb      <= (others => (others => '0'));
+      ecc_h   <= (others => '0');
+      ecc_s   <= (others => (others => '0'));
+      rec     <= (others => (others => '0'));
+      rec_n   <= 0;
+      valid   <= '0';
+      data    <= (others => '0');
+      last    <= '0';
+    elsif rising_edge(clk) then
+
+      ts <= ts+1 when en = '1' else (others => '0');
+
+      -- output record (packets are 32 pixels apart, so one never overtakes another)
+      valid <= '0';
+      last  <= '0';
+      if rec_n /= 0 then
+        valid <= '1';
+        data  <= rec(PKT_WORDS-rec_n);
+        last  <= '1' when rec_n = 1 else '0';
+        rec_n <= rec_n-1;
+      end if;
+
+      -- packets: 32 pixels each, header bits on channel 0 D2, subpacket
+      -- bits on channels 1 (even) and 2 (odd), D0..D3 for subpackets 0..3
+      if dec.island = '1' then
+        i := to_integer(unsigned(dec.pk_i));
+        h := hb;
+        s := sb;
+        h(i) := dec.d(0)(2);
+        for j in 0 to 3 loop
+          s(j)(2*i)   := dec.d(1)(j);
+          s(j)(2*i+1) := dec.d(2)(j);
+        end loop;
+        hb <= h;
+        sb <= s;
+        if i = 0 then
+          pk_ts <= std_logic_vector(ts);
+          ecc_h <= bch_ecc_1(x"00", dec.d(0)(2));
+        elsif i < 24 then
+          ecc_h <= bch_ecc_1(ecc_h, dec.d(0)(2));
+        end if;
+        for j in 0 to 3 loop
+          if i = 0 then
+            ecc_s(j) <= bch_ecc_2(x"00", dec.d(2)(j) & dec.d(1)(j));
+          elsif i < 28 then
+            ecc_s(j) <= bch_ecc_2(ecc_s(j), dec.d(2)(j) & dec.d(1)(j));
+          end if;
+        end loop;
+        if i = 31 and en = '1' then
+          st := (others => '0');
+          st(0) := '1' when ecc_h /= h(31 downto 24) else '0';
+          for j in 0 to 3 loop
+            st(1+j) := '1' when ecc_s(j) /= s(j)(63 downto 56) else '0';
+          end loop;
+          r := s(3)(55 downto 0) & s(2)(55 downto 0) & s(1)(55 downto 0) & s(0)(55 downto 0) & st & h(23 downto 0);
+          rec(0) <= pk_ts;
+          for k in 1 to PKT_WORDS-1 loop
+            rec(k) <= r(64*k-1 downto 64*(k-1));
+          end loop;
+          rec_n <= PKT_WORDS;
+        end if;
+      end if;
+
+    end if;
+  end process;
+
+end architecture synth;
@@ -21,6 +21,7 @@ library ieee;
 library work;
   use work.tyto_types_pkg.all;
   use work.axi4s_pkg.all;
+  use work.tmds_cap_dec_pkg.all;
 
 package tmds_cap_stream_pkg is
 
@@ -31,12 +32,29 @@ package tmds_cap_stream_pkg is
       pclk        : in    std_logic;
       tmds_lock   : in    std_logic;
       tmds        : in    slv10_vector(0 to 2);
+      tmds_o      : out   slv10_vector(0 to 2);
+      dec_o       : out   tmds_cap_dec_t;
 
       cap_rst     : in    std_logic;
       cap_size    : in    std_logic_vector(31 downto 0);
+      cap_chunk   : in    std_logic_vector(31 downto 0);
       cap_en      : in    std_logic;
       cap_test    : in    std_logic;
-
+      cap_dense   : in    std_logic;
+      cap_pkt     : in    std_logic;
+      trig_mode   : in    std_logic_vector(1 downto 0);
+      trig_vpol   : in    std_logic;
+      trig_pre    : in    std_logic_vector(31 downto 0);
+      trig_hdr    : in    std_logic_vector(23 downto 0);
+      trig_mask   : in    std_logic_vector(23 downto 0);
+      win_en      : in    std_logic;
+      win_hpol    : in    std_logic;
+      win_vpol    : in    std_logic;
+      win_line    : in    std_logic_vector(31 downto 0);
+      win_pix     : in    std_logic_vector(31 downto 0);
+      win_skip    : in    std_logic_vector(31 downto 0);
+
+      cap_arm     : out   std_logic;
       cap_run     : out   std_logic;
       cap_stop    : out   std_logic;
       cap_loss    : out   std_logic;
@@ -64,6 +82,9 @@ library work;
   use work.tyto_types_pkg.all;
   use work.sync_reg_pkg.all;
   use work.axi4s_pkg.all;
+  use work.tmds_cap_dec_pkg.all;
+  use work.tmds_cap_trig_pkg.all;
+  use work.tmds_cap_pkt_pkg.all;
 
 library unisim;
   use unisim.vcomponents.all;
@@ -75,16 +96,33 @@ entity tmds_cap_stream is
     pclk        : in    std_logic;
     tmds_lock   : in    std_logic;
     tmds        : in    slv10_vector(0 to 2);
+    tmds_o      : out   slv10_vector(0 to 2);          -- TMDS characters, delayed to align with dec_o
+    dec_o       : out   tmds_cap_dec_t;                -- decoded TMDS stream (for timing measurement)
 
     cap_rst     : in    std_logic;                     -- capture reset
     cap_size    : in    std_logic_vector(31 downto 0); -- capture size (pixels)
+    cap_chunk   : in    std_logic_vector(31 downto 0); -- capture chunk size (pixels) (0 = unchunked)
     cap_en      : in    std_logic;                     -- capture enable
     cap_test    : in    std_logic;                     -- capture test
-
+    cap_dense   : in    std_logic;                     -- capture dense (30 bit) packing (axi_clk domain)
+    cap_pkt     : in    std_logic;                     -- capture data island packets (not pixels)
+    trig_mode   : in    std_logic_vector(1 downto 0);  -- trigger mode (TRIG_MODE_xxx)
+    trig_vpol   : in    std_logic;                     -- trigger VSYNC edge (0 = rising, 1 = falling)
+    trig_pre    : in    std_logic_vector(31 downto 0); -- pre-trigger depth (pixels)
+    trig_hdr    : in    std_logic_vector(23 downto 0); -- trigger packet header value
+    trig_mask   : in    std_logic_vector(23 downto 0); -- trigger packet header mask
+    win_en      : in    std_logic;                     -- window enable
+    win_hpol    : in    std_logic;                     -- window HSYNC polarity (1 = active low)
+    win_vpol    : in    std_logic;                     -- window VSYNC polarity (1 = active low)
+    win_line    : in    std_logic_vector(31 downto 0); -- window lines: count (31:16) (0 = all), first (15:0)
+    win_pix     : in    std_logic_vector(31 downto 0); -- window pixels: count (31:16) (0 = all), first (15:0)
+    win_skip    : in    std_logic_vector(31 downto 0); -- window frames to skip after each captured frame
+
+    cap_arm     : out   std_logic;                     -- capture armed (waiting for trigger)
     cap_run     : out   std_logic;                     -- capture running
     cap_stop    : out   std_logic;                     -- capture stopped
     cap_loss    : out   std_logic;                     -- loss of TMDS lock
-    cap_ovf     : out   std_logic;                     -- FIFO overflow
+    cap_ovf     : out   std_logic;                     -- FIFO overflow (sticky)
     cap_unf     : out   std_logic;                     -- FIFO underflow
     cap_count   : out   std_logic_vector(31 downto 0); -- capture count (pixels)
 
@@ -102,6 +140,26 @@ architecture synth of tmds_cap_stream is
   signal cap_rst_s     : std_logic;                        -- capture reset, synchronized
   signal cap_en_s      : std_logic;                        -- capture enable, synchronized
   signal cap_en_s1     : std_logic;                        -- capture enable, synchronized, delayed by 1 clock
+  signal chunk_count   : std_logic_vector( 31 downto 0 );  -- pixel count within chunk
+  signal tmds_d        : slv10_vector(0 to 2);             -- TMDS characters, aligned with dec
+  signal dec           : tmds_cap_dec_t;                   -- decoded TMDS stream
+  signal trig          : std_logic;                        -- trigger event
+  signal tmds_trig     : slv10_vector(0 to 2);             -- TMDS characters, delayed for pre-trigger
+  signal dec_trig      : tmds_cap_dec_t;                   -- decoded, delayed for pre-trigger
+  signal tmds_c        : slv10_vector(0 to 2);             -- TMDS characters to capture
+  signal dec_c         : tmds_cap_dec_t;                   -- decoded, aligned with tmds_c
+  signal tmds_w        : slv10_vector(0 to 2);             -- tmds_c delayed to match window position
+  signal win_hs        : std_logic;                        -- HSYNC (active high) of tmds_w
+  signal win_vs        : std_logic;                        -- VSYNC (active high) of tmds_w
+  signal win_x         : unsigned( 15 downto 0 );          -- pixel position of tmds_w (from HSYNC leading edge)
+  signal win_y         : unsigned( 15 downto 0 );          -- line position of tmds_w (from VSYNC leading edge)
+  signal win_f         : unsigned( 31 downto 0 );          -- frames to skip before next captured frame
+  signal win_sync      : std_logic;                        -- VSYNC leading edge seen (window positions valid)
+  signal win_in        : std_logic;                        -- tmds_w is in window
+  signal px            : slv10_vector(0 to 2);             -- TMDS characters to write to FIFO
+  signal pkt_valid     : std_logic;                        -- packet record word valid
+  signal pkt_data      : std_logic_vector( 63 downto 0 );  -- packet record word
+  signal pkt_last      : std_logic;                        -- packet record last word
   signal fifo_we       : std_logic;                        -- FIFO write enable
   signal fifo_wd       : std_logic_vector( 63 downto 0 );  -- FIFO write data
   signal fifo_wx       : std_logic_vector(  7 downto 0 );  -- FIFO write extras
@@ -109,6 +167,12 @@ architecture synth of tmds_cap_stream is
   signal fifo_rd       : std_logic_vector( 63 downto 0 );  -- FIFO read data
   signal fifo_rx       : std_logic_vector(  7 downto 0 );  -- FIFO read extras
   signal fifo_ef       : std_logic;                        -- FIFO empty flag
+  signal fifo_wrerr    : std_logic;                        -- FIFO write error (overflow)
+  signal pk_acc        : std_logic_vector(119 downto 0 );  -- packer accumulator
+  signal pk_n          : integer range 0 to 60;            -- packer accumulator bit count
+  signal pk_data       : std_logic_vector( 63 downto 0 );  -- packer output data
+  signal pk_valid      : std_logic;                        -- packer output valid
+  signal pk_last       : std_logic;                        -- packer output last
 
   alias fifo_wd_lo   : std_logic_vector( 31 downto 0 ) is fifo_wd( 31 downto  0 );
   alias fifo_wd_hi   : std_logic_vector( 31 downto 0 ) is fifo_wd( 63 downto 32 );
@@ -152,15 +216,127 @@ begin
       q(0) => cap_rst_s
     );
 
+  -- decode (shared by trigger, packet extraction, window and timing measurement)
+
+  U_DEC: component tmds_cap_dec
+    port map (
+      rst    => prst,
+      clk    => pclk,
+      tmds_i => tmds,
+      tmds_o => tmds_d,
+      dec    => dec
+    );
+
+  tmds_o <= tmds_d;
+  dec_o  <= dec;
+
+  -- trigger
+
+  U_TRIG: component tmds_cap_trig
+    port map (
+      rst      => prst,
+      clk      => pclk,
+      tmds_i   => tmds_d,
+      dec_i    => dec,
+      mode     => trig_mode,
+      vs_pol   => trig_vpol,
+      pre      => trig_pre,
+      hdr      => trig_hdr,
+      hdr_mask => trig_mask,
+      trig     => trig,
+      tmds_o   => tmds_trig,
+      dec_o    => dec_trig
+    );
+
+  tmds_c <= tmds_d when trig_mode = TRIG_MODE_NONE else tmds_trig;
+  dec_c  <= dec    when trig_mode = TRIG_MODE_NONE else dec_trig;
+
+  -- window: track position relative to decoded sync (see tmds_cap_dec.vhd)
+  -- Pixel 0 of a line has the HSYNC leading edge, line 0 of a frame has the
+  -- VSYNC leading edge.
+
+  process(prst,pclk)
+    variable hs, vs   : std_logic;                    -- active high
+    variable x, y     : unsigned(15 downto 0);
+    variable f        : unsigned(31 downto 0);
+    variable sync     : std_logic;
+    variable in_x     : boolean;
+    variable in_y     : boolean;
+  begin
+    if prst = '1' then
+      tmds_w   <= (others => (others => '0'));
+      win_hs   <= '0';
+      win_vs   <= '0';
+      win_x    <= (others => '0');
+      win_y    <= (others => '0');
+      win_f    <= (others => '0');
+      win_sync <= '0';
+      win_in   <= '0';
+    elsif rising_edge(pclk) then
+      tmds_w <= tmds_c;
+      hs := dec_c.hs xor win_hpol;
+      vs := dec_c.vs xor win_vpol;
+      x := win_x+1; y := win_y; f := win_f; sync := win_sync;
+      if hs = '1' and win_hs = '0' then
+        x := (others => '0');
+        y := win_y+1;
+      end if;
+      if vs = '1' and win_vs = '0' then
+        y := (others => '0');
+        sync := '1';
+        f := win_f-1;
+        if win_f = 0 then
+          f := unsigned(win_skip);
+        end if;
+      end if;
+      in_x := x >= unsigned(win_pix(15 downto 0)) and
+        (win_pix(31 downto 16) = x"0000" or x-unsigned(win_pix(15 downto 0)) < unsigned(win_pix(31 downto 16)));
+      in_y := y >= unsigned(win_line(15 downto 0)) and
+        (win_line(31 downto 16) = x"0000" or y-unsigned(win_line(15 downto 0)) < unsigned(win_line(31 downto 16)));
+      win_hs   <= hs;
+      win_vs   <= vs;
+      win_x    <= x;
+      win_y    <= y;
+      win_f    <= f;
+      win_sync <= sync;
+      win_in   <= '1' when sync = '1' and f = unsigned(win_skip) and in_x and in_y else '0';
+    end if;
+  end process;
+
+  -- data island packets
+
+  U_PKT: component tmds_cap_pkt
+    port map (
+      rst   => prst,
+      clk   => pclk,
+      dec   => dec_c,
+      en    => cap_run and cap_pkt,
+      valid => pkt_valid,
+      data  => pkt_data,
+      last  => pkt_last
+    );
+
   -- TMDS stream ---> FIFO
+  -- Packet captures write packet records (PKT_WORDS x 64 bits) in place of
+  -- pixels; sizes and counts are then in packets, and the window is ignored.
+  -- Plain captures (no trigger or window) need no decode, so take the
+  -- characters straight from the input, without its latency.
+
+  px <=
+    tmds_w when win_en = '1' else
+    tmds   when trig_mode = TRIG_MODE_NONE else
+    tmds_trig;
 
   process(cap_rst_s,pclk)
   begin
     if cap_rst_s = '1' then
       cap_en_s1    <= '0';
+      cap_arm      <= '0';
       cap_run      <= '0';
       cap_stop     <= '0';
       cap_count    <= (others => '0');
+      cap_ovf      <= '0';
+      chunk_count  <= (others => '0');
       fifo_we      <= '0';
       fifo_wd      <= (others => '0');
       fifo_wx_lo   <= '0';
@@ -169,29 +345,70 @@ begin
     elsif rising_edge(pclk) then
       cap_en_s1 <= cap_en_s;
       if cap_en_s = '1' and cap_en_s1 = '0' then
-        cap_run   <= '1';
-        cap_stop  <= '0';
-        cap_count <= (others => '0');
+        if trig_mode = TRIG_MODE_NONE then
+          cap_run   <= '1';
+        else
+          cap_arm   <= '1';
+        end if;
+        cap_stop    <= '0';
+        cap_count   <= (others => '0');
+        cap_ovf     <= '0';
+        chunk_count <= (others => '0');
+      end if;
+      if cap_arm = '1' and trig = '1' then
+        cap_arm <= '0';
+        cap_run <= '1';
+      end if;
+      if fifo_wrerr = '1' then
+        cap_ovf <= '1';
       end if;
       if cap_run = '1' then
         fifo_we      <= '0';
         fifo_wx_last <= '0';
-        if cap_count(0) = '0' then
-          fifo_wd_lo <= not cap_count when cap_test = '1' else "00" & tmds(2) & tmds(1) & tmds(0);
-          fifo_wx_lo <= '1';
-          fifo_wx_hi <= '0';
-        else
-          fifo_wd_hi <= not cap_count when cap_test = '1' else "00" & tmds(2) & tmds(1) & tmds(0);
-          fifo_wx_hi <= '1';
-          fifo_we    <= '1';
+        if cap_pkt = '1' then
+          if pkt_valid = '1' then
+            fifo_wd    <= pkt_data;
+            fifo_wx_lo <= '1';
+            fifo_wx_hi <= '1';
+            fifo_we    <= '1';
+            if pkt_last = '1' then
+              chunk_count <= std_logic_vector(unsigned(chunk_count)+1);
+              if std_logic_vector(unsigned(chunk_count)+1) = cap_chunk then
+                fifo_wx_last <= '1';
+                chunk_count  <= (others => '0');
+              end if;
+              if std_logic_vector(unsigned(cap_count)+1) = cap_size then
+                fifo_wx_last <= '1';
+                cap_run      <= '0';
+                cap_stop     <= '1';
+              end if;
+              cap_count <= std_logic_vector(unsigned(cap_count)+1);
+            end if;
+          end if;
+        elsif win_en = '0' or win_in = '1' then -- window: pixels outside are skipped
+          if cap_count(0) = '0' then
+            fifo_wd_lo <= not cap_count when cap_test = '1' else "00" & px(2) & px(1) & px(0);
+            fifo_wx_lo <= '1';
+            fifo_wx_hi <= '0';
+          else
+            fifo_wd_hi <= not cap_count when cap_test = '1' else "00" & px(2) & px(1) & px(0);
+            fifo_wx_hi <= '1';
+            fifo_we    <= '1';
+          end if;
+          -- chunking: end each chunk with tlast so that the DMA can be re-armed for the next one
+          chunk_count <= std_logic_vector(unsigned(chunk_count)+1);
+          if std_logic_vector(unsigned(chunk_count)+1) = cap_chunk then
+            fifo_wx_last <= '1';
+            chunk_count  <= (others => '0');
+          end if;
+          if std_logic_vector(unsigned(cap_count)+1) = cap_size then
+            fifo_wx_last <= '1';
+            fifo_we      <= '1';
+            cap_run      <= '0';
+            cap_stop     <= '1';
+          end if;
+          cap_count <= std_logic_vector(unsigned(cap_count)+1);
         end if;
-        if std_logic_vector(unsigned(cap_count)+1) = cap_size then
-          fifo_wx_last <= '1';
-          fifo_we      <= '1';
-          cap_run      <= '0';
-          cap_stop     <= '1';
-        end if;
-        cap_count <= std_logic_vector(unsigned(cap_count)+1);
       else
         fifo_we      <= '0';
         fifo_wd      <= (others => '0');
@@ -238,7 +455,7 @@ begin
       rdcount       => open,
       rderr         => cap_unf,
       wrcount       => open,
-      wrerr         => cap_ovf,
+      wrerr         => fifo_wrerr,
       injectdbiterr => '0',
       injectsbiterr => '0',
       dbiterr       => open,
@@ -248,12 +465,54 @@ begin
 
   -- FIFO ---> AXI stream
 
-  fifo_re <= maxi4s_mosi.tvalid and maxi4s_miso.tready;
+  -- sparse: 2 pixels per 64 bit word, each in the lower 30 bits of 32
+  -- dense: 32 pixels per 15 x 64 bit words, 30 bits each, no gaps (LSB first)
+  -- Dense packing requires the capture and chunk sizes to be multiples of 32.
+  -- Sparse chunks must be even: a chunk ending on the lower half of a word
+  -- would lose its tlast.
+
+  fifo_re <=
+    not fifo_ef and maxi4s_miso.tready                  when cap_dense = '0' else
+    not fifo_ef and (maxi4s_miso.tready or not pk_valid);
+
+  process(axi_rst_n,cap_rst,axi_clk)
+    variable v : std_logic_vector(119 downto 0);
+  begin
+    if axi_rst_n = '0' or cap_rst = '1' then
+      pk_acc   <= (others => '0');
+      pk_n     <= 0;
+      pk_data  <= (others => '0');
+      pk_valid <= '0';
+      pk_last  <= '0';
+    elsif rising_edge(axi_clk) then
+      if maxi4s_miso.tready = '1' then
+        pk_valid <= '0';
+      end if;
+      if cap_dense = '1' and fifo_re = '1' then
+        v := pk_acc;
+        for i in 0 to 15 loop
+          if pk_n = 4*i then
+            v(4*i+59 downto 4*i) := fifo_rd(61 downto 32) & fifo_rd(29 downto 0);
+          end if;
+        end loop;
+        if pk_n = 0 then
+          pk_acc <= v;
+          pk_n   <= 60;
+        else
+          pk_data  <= v(63 downto 0);
+          pk_valid <= '1';
+          pk_last  <= fifo_rx_last;
+          pk_acc   <= x"0000000000000000" & v(119 downto 64);
+          pk_n     <= pk_n-4;
+        end if;
+      end if;
+    end if;
+  end process;
 
-  maxi4s_mosi.tdata             <= fifo_rd;
-  maxi4s_mosi.tkeep(3 downto 0) <= (others => fifo_rx_lo);
-  maxi4s_mosi.tkeep(7 downto 4) <= (others => fifo_rx_hi);
-  maxi4s_mosi.tvalid            <= not fifo_ef;
-  maxi4s_mosi.tlast             <= fifo_rx_last;
+  maxi4s_mosi.tdata             <= fifo_rd               when cap_dense = '0' else pk_data;
+  maxi4s_mosi.tkeep(3 downto 0) <= (others => fifo_rx_lo) when cap_dense = '0' else (others => '1');
+  maxi4s_mosi.tkeep(7 downto 4) <= (others => fifo_rx_hi) when cap_dense = '0' else (others => '1');
+  maxi4s_mosi.tvalid            <= not fifo_ef           when cap_dense = '0' else pk_valid;
+  maxi4s_mosi.tlast             <= fifo_rx_last          when cap_dense = '0' else pk_last;
 
 end architecture synth;
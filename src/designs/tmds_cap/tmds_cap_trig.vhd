@@ -0,0 +1,192 @@
+--------------------------------------------------------------------------------
+-- tmds_cap_trig.vhd                                                          --
+-- Trigger unit for tmds_cap design.                                          --
+--------------------------------------------------------------------------------
+-- (C) Copyright 2023 Adam Barnes <ambarnes@gmail.com>                        --
+-- This file is part of The Tyto Project. The Tyto Project is free software:  --
+-- you can redistribute it and/or modify it under the terms of the GNU Lesser --
+-- General Public License as published by the Free Software Foundation,       --
+-- either version 3 of the License, or (at your option) any later version.    --
+-- The Tyto Project is distributed in the hope that it will be useful, but    --
+-- WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY --
+-- or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public     --
+-- License for more details. You should have received a copy of the GNU       --
+-- Lesser General Public License along with The Tyto Project. If not, see     --
+-- https://www.gnu.org/licenses/.                                             --
+--------------------------------------------------------------------------------
+
+library ieee;
+  use ieee.std_logic_1164.all;
+
+library work;
+  use work.tyto_types_pkg.all;
+  use work.tmds_cap_dec_pkg.all;
+
+package tmds_cap_trig_pkg is
+
+  -- trigger modes
+  constant TRIG_MODE_NONE : std_logic_vector(1 downto 0) := "00"; -- immediate
+  constant TRIG_MODE_VS   : std_logic_vector(1 downto 0) := "01"; -- VSYNC edge
+  constant TRIG_MODE_DI   : std_logic_vector(1 downto 0) := "10"; -- data island preamble
+  constant TRIG_MODE_PH   : std_logic_vector(1 downto 0) := "11"; -- packet header match
+
+  component tmds_cap_trig is
+    generic (
+      PRE_LOG2  : integer := 12
+    );
+    port (
+      rst       : in    std_logic;
+      clk       : in    std_logic;
+      tmds_i    : in    slv10_vector(0 to 2);
+      dec_i     : in    tmds_cap_dec_t;
+      mode      : in    std_logic_vector(1 downto 0);
+      vs_pol    : in    std_logic;
+      pre       : in    std_logic_vector(31 downto 0);
+      hdr       : in    std_logic_vector(23 downto 0);
+      hdr_mask  : in    std_logic_vector(23 downto 0);
+      trig      : out   std_logic;
+      tmds_o    : out   slv10_vector(0 to 2);
+      dec_o     : out   tmds_cap_dec_t
+    );
+  end component tmds_cap_trig;
+
+end package tmds_cap_trig_pkg;
+
+--------------------------------------------------------------------------------
+-- Watches the decoded TMDS stream (see tmds_cap_dec.vhd) for a trigger event,
+-- and provides a delayed copy of the stream (characters and decode) such that
+-- a capture started on the clock after trig is asserted begins "pre" pixels
+-- before the trigger pixel:
+--  VSYNC edge     : first pixel with VSYNC at its new level (vs_pol = 0 for
+--                   rising edge, 1 for falling)
+--  data island    : 8th (last) pixel of a data island preamble
+--  packet header  : 24th (last) header bit of a data island packet whose
+--                   header bytes (HB2:HB1:HB0) match hdr where hdr_mask is set
+-- pre is limited to 2^PRE_LOG2-3 pixels.
+
+library ieee;
+  use ieee.std_logic_1164.all;
+  use ieee.numeric_std.all;
+
+library work;
+  use work.tyto_types_pkg.all;
+  use work.tmds_cap_dec_pkg.all;
+  use work.tmds_cap_trig_pkg.all;
+
+entity tmds_cap_trig is
+  generic (
+    PRE_LOG2  : integer := 12                       -- log2 of pre-trigger buffer depth (pixels)
+  );
+  port (
+    rst       : in    std_logic;                     -- reset
+    clk       : in    std_logic;                     -- pixel clock
+    tmds_i    : in    slv10_vector(0 to 2);          -- TMDS characters in
+    dec_i     : in    tmds_cap_dec_t;                -- decoded (for tmds_i)
+    mode      : in    std_logic_vector(1 downto 0);  -- TRIG_MODE_xxx
+    vs_pol    : in    std_logic;                     -- VSYNC edge: 0 = rising, 1 = falling
+    pre       : in    std_logic_vector(31 downto 0); -- pre-trigger depth (pixels)
+    hdr       : in    std_logic_vector(23 downto 0); -- packet header match value
+    hdr_mask  : in    std_logic_vector(23 downto 0); -- packet header match mask
+    trig      : out   std_logic;                     -- trigger event
+    tmds_o    : out   slv10_vector(0 to 2);          -- TMDS characters out (delayed)
+    dec_o     : out   tmds_cap_dec_t                 -- decoded (for tmds_o)
+  );
+end entity tmds_cap_trig;
+
+architecture synth of tmds_cap_trig is
+
+  constant DEPTH    : integer := 2**PRE_LOG2;
+  constant WIDTH    : integer := 30+TMDS_CAP_DEC_BITS;
+
+  type ram_t is array(0 to DEPTH-1) of std_logic_vector(WIDTH-1 downto 0);
+
+  signal ram        : ram_t;
+  signal ram_wd     : std_logic_vector(WIDTH-1 downto 0); -- write data
+  signal ram_rd     : std_logic_vector(WIDTH-1 downto 0); -- read data
+  signal ram_wa     : unsigned(PRE_LOG2-1 downto 0);      -- write address
+  signal ram_ra     : unsigned(PRE_LOG2-1 downto 0);      -- read address
+  signal pre_c      : unsigned(PRE_LOG2-1 downto 0);      -- pre, clamped
+
+  signal vs         : std_logic;                          -- VSYNC of last pixel
+  signal pk_hdr     : std_logic_vector(23 downto 0);      -- packet header bits so far
+
+begin
+
+  -- pre-trigger delay line (characters and decode)
+
+  pre_c <=
+    to_unsigned(DEPTH-3,PRE_LOG2) when unsigned(pre) > DEPTH-3 else
+    unsigned(pre(PRE_LOG2-1 downto 0));
+
+  ram_wd <=
+    dec_i.vs & dec_i.hs & dec_i.d(2) & dec_i.d(1) & dec_i.d(0) & dec_i.pk_i &
+    dec_i.island & dec_i.pre_di & dec_i.video & tmds_i(2) & tmds_i(1) & tmds_i(0);
+
+  process(clk)
+  begin
+    if rising_edge(clk) then
+      ram(to_integer(ram_wa)) <= ram_wd;
+      ram_rd <= ram(to_integer(ram_ra));
+    end if;
+  end process;
+
+  tmds_o(0)    <= ram_rd( 9 downto  0);
+  tmds_o(1)    <= ram_rd(19 downto 10);
+  tmds_o(2)    <= ram_rd(29 downto 20);
+  dec_o.video  <= ram_rd(30);
+  dec_o.pre_di <= ram_rd(31);
+  dec_o.island <= ram_rd(32);
+  dec_o.pk_i   <= ram_rd(37 downto 33);
+  dec_o.d(0)   <= ram_rd(41 downto 38);
+  dec_o.d(1)   <= ram_rd(45 downto 42);
+  dec_o.d(2)   <= ram_rd(49 downto 46);
+  dec_o.hs     <= ram_rd(50);
+  dec_o.vs     <= ram_rd(51);
+
+  -- trig is 1 clock behind tmds_i, as is the RAM (written from tmds_i, read registered)
+  -- so reading pre+1 locations back aligns the first captured pixel
+  ram_ra <= ram_wa - pre_c - 1;
+
+  -- detect
+
+  process(rst,clk)
+    variable i : integer range 0 to 31;
+    variable h : std_logic_vector(23 downto 0);
+  begin
+    if rst = '1' then
+      ram_wa <= (others => '0');
+      vs     <= '0';
+      pk_hdr <= (others => '0');
+      trig   <= '0';
+    elsif rising_edge(clk) then
+      ram_wa <= ram_wa+1;
+      trig   <= '0';
+
+      -- VSYNC edge
+      vs <= dec_i.vs;
+      if mode = TRIG_MODE_VS and dec_i.vs /= vs and dec_i.vs = not vs_pol then
+        trig <= '1';
+      end if;
+
+      -- data island preamble
+      if mode = TRIG_MODE_DI and dec_i.pre_di = '1' then
+        trig <= '1';
+      end if;
+
+      -- packets: header bits are channel 0 D2, LSB of HB0 first
+      if dec_i.island = '1' then
+        i := to_integer(unsigned(dec_i.pk_i));
+        if i < 24 then
+          h := pk_hdr;
+          h(i) := dec_i.d(0)(2);
+          pk_hdr <= h;
+          if i = 23 and mode = TRIG_MODE_PH and ((h xor hdr) and hdr_mask) = x"000000" then
+            trig <= '1';
+          end if;
+        end if;
+      end if;
+
+    end if;
+  end process;
+
+end architecture synth;
@@ -0,0 +1,302 @@
+--------------------------------------------------------------------------------
+-- tmds_cap_vtm.vhd                                                           --
+-- Video timing measurement for tmds_cap design.                              --
+--------------------------------------------------------------------------------
+-- (C) Copyright 2023 Adam Barnes <ambarnes@gmail.com>                        --
+-- This file is part of The Tyto Project. The Tyto Project is free software:  --
+-- you can redistribute it and/or modify it under the terms of the GNU Lesser --
+-- General Public License as published by the Free Software Foundation,       --
+-- either version 3 of the License, or (at your option) any later version.    --
+-- The Tyto Project is distributed in the hope that it will be useful, but    --
+-- WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY --
+-- or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public     --
+-- License for more details. You should have received a copy of the GNU       --
+-- Lesser General Public License along with The Tyto Project. If not, see     --
+-- https://www.gnu.org/licenses/.                                             --
+--------------------------------------------------------------------------------
+
+library ieee;
+  use ieee.std_logic_1164.all;
+
+library work;
+  use work.tyto_types_pkg.all;
+  use work.tmds_cap_dec_pkg.all;
+
+package tmds_cap_vtm_pkg is
+
+  type tmds_cap_vtm_t is record
+    hvalid      : std_logic;                     -- horizontal measurements stable
+    vvalid      : std_logic;                     -- vertical measurements stable
+    interlace   : std_logic;                     -- interlaced (two fields per frame)
+    hpol        : std_logic;                     -- HSYNC polarity (1 = active high)
+    vpol        : std_logic;                     -- VSYNC polarity (1 = active high)
+    h_total     : std_logic_vector(15 downto 0); -- pixels per line
+    h_active    : std_logic_vector(15 downto 0); -- active video pixels per line
+    h_fp        : std_logic_vector(15 downto 0); -- front porch (active to sync) (pixels)
+    h_sync      : std_logic_vector(15 downto 0); -- sync (pixels)
+    h_bp        : std_logic_vector(15 downto 0); -- back porch (sync to active) (pixels)
+    v_total     : std_logic_vector(15 downto 0); -- lines per frame
+    v_active    : std_logic_vector(15 downto 0); -- active video lines (first field)
+    v_fp        : std_logic_vector(15 downto 0); -- front porch (active to sync) (whole lines)
+    v_sync      : std_logic_vector(15 downto 0); -- sync (lines)
+    v_bp        : std_logic_vector(15 downto 0); -- back porch (sync to active) (lines)
+    f_total     : std_logic_vector(31 downto 0); -- pixels per frame
+  end record tmds_cap_vtm_t;
+
+  component tmds_cap_vtm is
+    port (
+      rst       : in    std_logic;
+      clk       : in    std_logic;
+      lock      : in    std_logic;
+      tmds      : in    slv10_vector(0 to 2);
+      dec       : in    tmds_cap_dec_t;
+      vtm       : out   tmds_cap_vtm_t;
+      de        : out   std_logic;
+      px        : out   slv10_vector(0 to 2);
+      fs        : out   std_logic
+    );
+  end component tmds_cap_vtm;
+
+end package tmds_cap_vtm_pkg;
+
+--------------------------------------------------------------------------------
+-- Measures video timing continuously from the decoded TMDS stream (see
+-- tmds_cap_dec.vhd: active video, with its guard band excluded, and syncs).
+-- Sync polarities are the opposite of the sync levels during active video.
+-- Horizontal values are latched at the end of every line containing active
+-- video, vertical values at the end of every frame; each is valid once it
+-- has been measured the same twice running. For interlaced video, vertical
+-- values other than v_total are for the first field (the one whose VSYNC
+-- leading edge coincides with that of HSYNC).
+-- The classified stream is also output: de flags the characters on px that
+-- are active video, and fs pulses at the VSYNC leading edge of every field.
+
+library ieee;
+  use ieee.std_logic_1164.all;
+  use ieee.numeric_std.all;
+
+library work;
+  use work.tyto_types_pkg.all;
+  use work.tmds_cap_dec_pkg.all;
+  use work.tmds_cap_vtm_pkg.all;
+
+entity tmds_cap_vtm is
+  port (
+    rst       : in    std_logic;                     -- reset
+    clk       : in    std_logic;                     -- pixel clock
+    lock      : in    std_logic;                     -- TMDS lock
+    tmds      : in    slv10_vector(0 to 2);          -- TMDS characters
+    dec       : in    tmds_cap_dec_t;                -- decoded (for tmds)
+    vtm       : out   tmds_cap_vtm_t;                -- measurements
+    de        : out   std_logic;                     -- px is active video
+    px        : out   slv10_vector(0 to 2);          -- TMDS characters
+    fs        : out   std_logic                      -- field start (VSYNC leading edge)
+  );
+end entity tmds_cap_vtm;
+
+architecture synth of tmds_cap_vtm is
+
+  signal act        : std_logic;                          -- active video
+  signal hs         : std_logic;                          -- HSYNC (as sent)
+  signal vs         : std_logic;                          -- VSYNC (as sent)
+
+  signal act_1      : std_logic;                          -- act, delayed
+  signal hs_1       : std_logic;                          -- HSYNC (active high), delayed
+  signal vs_1       : std_logic;                          -- VSYNC (active high), delayed
+  signal x          : unsigned(15 downto 0);              -- pixel position (from HSYNC leading edge)
+  signal x_se       : unsigned(15 downto 0);              -- HSYNC trailing edge position
+  signal x_as       : unsigned(15 downto 0);              -- active start position
+  signal x_ae       : unsigned(15 downto 0);              -- active end position
+  signal line_act   : std_logic;                          -- line contains active video
+  signal y          : unsigned(15 downto 0);              -- line position (from VSYNC leading edge)
+  signal y_se       : unsigned(15 downto 0);              -- VSYNC trailing edge line
+  signal y_as       : unsigned(15 downto 0);              -- first active line
+  signal y_ae       : unsigned(15 downto 0);              -- line after last active line
+  signal y_fp       : unsigned(15 downto 0);              -- front porch
+  signal frame_act  : std_logic;                          -- active video seen in first field
+  signal fp_done    : std_logic;                          -- front porch measured
+  signal field2     : std_logic;                          -- in second field (interlace)
+  signal frame_ok   : std_logic;                          -- first frame start seen
+  signal f          : unsigned(31 downto 0);              -- pixel position (from VSYNC leading edge)
+
+  signal m          : tmds_cap_vtm_t;                     -- measurements
+
+begin
+
+  act <= dec.video;
+  hs  <= dec.hs;
+  vs  <= dec.vs;
+  px  <= tmds;
+
+  -- measure
+
+  process(rst,clk)
+    variable hsa, vsa   : std_logic;             -- syncs, active high
+    variable hs_lead    : boolean;
+    variable hs_trail   : boolean;
+    variable vs_lead    : boolean;
+    variable vs_trail   : boolean;
+    variable xn, yn     : unsigned(15 downto 0); -- position of this pixel
+    variable h_total    : unsigned(15 downto 0);
+    variable h_active   : unsigned(15 downto 0);
+    variable h_fp       : unsigned(15 downto 0);
+    variable h_sync     : unsigned(15 downto 0);
+    variable h_bp       : unsigned(15 downto 0);
+    variable v_total    : unsigned(15 downto 0);
+    variable v_active   : unsigned(15 downto 0);
+    variable v_sync     : unsigned(15 downto 0);
+    variable v_bp       : unsigned(15 downto 0);
+  begin
+    if rst = '1' then
+      act_1     <= '0';
+      hs_1      <= '0';
+      vs_1      <= '0';
+      x         <= (others => '0');
+      x_se      <= (others => '0');
+      x_as      <= (others => '0');
+      x_ae      <= (others => '0');
+      line_act  <= '0';
+      y         <= (others => '0');
+      y_se      <= (others => '0');
+      y_as      <= (others => '0');
+      y_ae      <= (others => '0');
+      y_fp      <= (others => '0');
+      frame_act <= '0';
+      fp_done   <= '0';
+      field2    <= '0';
+      frame_ok  <= '0';
+      f         <= (others => '0');
+      fs        <= '0';
+      m         <= (
+          hvalid    => '0',
+          vvalid    => '0',
+          interlace => '0',
+          hpol      => '0',
+          vpol      => '0',
+          f_total   => (others => '0'),
+          others    => (others => '0')
+        );
+    elsif rising_edge(clk) then
+
+      if act = '1' then
+        m.hpol <= not hs;
+        m.vpol <= not vs;
+      end if;
+      hsa      := hs xor not m.hpol;
+      vsa      := vs xor not m.vpol;
+      hs_lead  := hsa = '1' and hs_1 = '0';
+      hs_trail := hsa = '0' and hs_1 = '1';
+      vs_lead  := vsa = '1' and vs_1 = '0';
+      vs_trail := vsa = '0' and vs_1 = '1';
+      act_1    <= act;
+      hs_1     <= hsa;
+      vs_1     <= vsa;
+      fs       <= '1' when vs_lead else '0';
+
+      -- horizontal
+      xn := x+1;
+      yn := y;
+      if hs_lead then
+        if line_act = '1' then
+          h_total  := x+1;
+          h_active := x_ae-x_as;
+          h_fp     := x+1-x_ae;
+          h_sync   := x_se;
+          h_bp     := x_as-x_se;
+          m.h_total  <= std_logic_vector(h_total);
+          m.h_active <= std_logic_vector(h_active);
+          m.h_fp     <= std_logic_vector(h_fp);
+          m.h_sync   <= std_logic_vector(h_sync);
+          m.h_bp     <= std_logic_vector(h_bp);
+          m.hvalid   <= '1' when
+            std_logic_vector(h_total) = m.h_total and std_logic_vector(h_active) = m.h_active and
+            std_logic_vector(h_fp) = m.h_fp and std_logic_vector(h_sync) = m.h_sync and
+            std_logic_vector(h_bp) = m.h_bp
+            else '0';
+        end if;
+        line_act <= '0';
+        xn := (others => '0');
+        yn := y+1;
+      elsif x = x"FFFF" then
+        m.hvalid <= '0'; -- no HSYNC
+      end if;
+      if hs_trail then
+        x_se <= xn;
+      end if;
+      if act = '1' then
+        line_act <= '1';
+        if act_1 = '0' then
+          x_as <= xn;
+        end if;
+      elsif act_1 = '1' then
+        x_ae <= xn;
+      end if;
+
+      -- vertical
+      if vs_lead and frame_act = '1' and fp_done = '0' then
+        y_fp    <= yn-y_ae;
+        fp_done <= '1';
+      end if;
+      if vs_lead and hs_lead then
+        -- frame (first field) starts
+        if frame_ok = '1' and frame_act = '1' then
+          v_total  := yn;
+          v_active := y_ae-y_as;
+          v_sync   := y_se;
+          v_bp     := y_as-y_se;
+          m.v_total   <= std_logic_vector(v_total);
+          m.v_active  <= std_logic_vector(v_active);
+          m.v_fp      <= std_logic_vector(y_fp) when fp_done = '1' else std_logic_vector(yn-y_ae);
+          m.v_sync    <= std_logic_vector(v_sync);
+          m.v_bp      <= std_logic_vector(v_bp);
+          m.f_total   <= std_logic_vector(f+1);
+          m.interlace <= field2;
+          m.vvalid    <= '1' when
+            std_logic_vector(v_total) = m.v_total and std_logic_vector(v_active) = m.v_active and
+            std_logic_vector(v_sync) = m.v_sync and std_logic_vector(v_bp) = m.v_bp and
+            std_logic_vector(f+1) = m.f_total and field2 = m.interlace
+            else '0';
+        end if;
+        yn        := (others => '0');
+        f         <= (others => '0');
+        frame_act <= '0';
+        fp_done   <= '0';
+        field2    <= '0';
+        frame_ok  <= '1';
+      else
+        if vs_lead then
+          field2 <= '1'; -- VSYNC mid line
+        end if;
+        f <= f+1;
+        if y = x"FFFF" then
+          m.vvalid <= '0'; -- no VSYNC
+        end if;
+      end if;
+      if field2 = '0' then
+        if vs_trail then
+          y_se <= yn;
+        end if;
+        if act = '1' and act_1 = '0' and frame_act = '0' then
+          y_as      <= yn;
+          frame_act <= '1';
+        end if;
+        if act = '0' and act_1 = '1' then
+          y_ae <= yn+1;
+        end if;
+      end if;
+
+      x <= xn;
+      y <= yn;
+
+      if lock = '0' then
+        m.hvalid <= '0';
+        m.vvalid <= '0';
+      end if;
+
+    end if;
+  end process;
+
+  vtm <= m;
+  de  <= act;
+
+end architecture synth;
@@ -36,6 +36,7 @@ package tmds_cap_io_pkg is
       saxi4_miso     : out   axi4_a32d32_h_miso_t;
       maxi4s_mosi    : out   axi4s_64_mosi_t;
       maxi4s_miso    : in    axi4s_64_miso_t;
+      cap_irq        : out   std_logic;
 
       gpo            : out   std_logic_vector(7 downto 0);
       gpi            : in    std_logic_vector(7 downto 0);
@@ -70,7 +71,10 @@ library work;
   use work.hdmi_rx_selectio_pkg.all;
   use work.hdmi_tx_selectio_pkg.all;
   use work.tmds_cap_csr_pkg.all;
+  use work.tmds_cap_dec_pkg.all;
   use work.tmds_cap_stream_pkg.all;
+  use work.tmds_cap_vtm_pkg.all;
+  use work.tmds_cap_crc_pkg.all;
 
 entity tmds_cap_io is
   port (
@@ -84,6 +88,7 @@ entity tmds_cap_io is
     saxi4_miso     : out   axi4_a32d32_h_miso_t;
     maxi4s_mosi    : out   axi4s_64_mosi_t;
     maxi4s_miso    : in    axi4s_64_miso_t;
+    cap_irq        : out   std_logic;
 
     gpo            : out   std_logic_vector(7 downto 0);
     gpi            : in    std_logic_vector(7 downto 0);
@@ -114,6 +119,8 @@ architecture synth of tmds_cap_io is
   signal pclk           : std_logic;
   signal sclk           : std_logic;
   signal tmds           : slv10_vector(0 to 2);
+  signal tmds_d         : slv10_vector(0 to 2);
+  signal dec            : tmds_cap_dec_t;
   signal rx_status      : hdmi_rx_selectio_status_t;
   signal tmds_lock      : std_logic;
   signal hdmi_tx_clk    : std_logic;
@@ -121,14 +128,35 @@ architecture synth of tmds_cap_io is
 
   signal cap_rst        : std_logic;                     -- capture reset
   signal cap_size       : std_logic_vector(31 downto 0); -- capture size (pixels)
+  signal cap_chunk      : std_logic_vector(31 downto 0); -- capture chunk size (pixels)
   signal cap_en         : std_logic;                     -- capture enable
   signal cap_test       : std_logic;                     -- capture test
+  signal cap_dense      : std_logic;                     -- capture dense (30 bit) packing
+  signal cap_pkt        : std_logic;                     -- capture data island packets
+  signal trig_mode      : std_logic_vector(1 downto 0);  -- trigger mode
+  signal trig_vpol      : std_logic;                     -- trigger VSYNC edge
+  signal trig_pre       : std_logic_vector(31 downto 0); -- pre-trigger depth (pixels)
+  signal trig_hdr       : std_logic_vector(23 downto 0); -- trigger packet header value
+  signal trig_mask      : std_logic_vector(23 downto 0); -- trigger packet header mask
+  signal win_en         : std_logic;                     -- window enable
+  signal win_hpol       : std_logic;                     -- window HSYNC polarity
+  signal win_vpol       : std_logic;                     -- window VSYNC polarity
+  signal win_line       : std_logic_vector(31 downto 0); -- window lines (count:first)
+  signal win_pix        : std_logic_vector(31 downto 0); -- window pixels (count:first)
+  signal win_skip       : std_logic_vector(31 downto 0); -- window frames skipped
+  signal cap_arm        : std_logic;                     -- capture armed (waiting for trigger)
   signal cap_run        : std_logic;                     -- capture running
   signal cap_stop       : std_logic;                     -- capture stopped
   signal cap_loss       : std_logic;                     -- capture loss of TMDS lock
   signal cap_ovf        : std_logic;                     -- capture FIFO overflow
   signal cap_unf        : std_logic;                     -- capture FIFO underflow
   signal cap_count      : std_logic_vector(31 downto 0); -- capture count (pixels)
+  signal vtm            : tmds_cap_vtm_t;                -- video timing measurements
+  signal vtm_de         : std_logic;                     -- active video (from timing measurement)
+  signal vtm_px         : slv10_vector(0 to 2);          -- TMDS characters (from timing measurement)
+  signal vtm_fs         : std_logic;                     -- field start (from timing measurement)
+  signal crc            : std_logic_vector(31 downto 0); -- video signature of last field
+  signal crc_t          : std_logic;                     -- video signature toggle
 
 begin
 
@@ -149,14 +177,33 @@ begin
       tmds_status    => rx_status,
       cap_rst        => cap_rst,
       cap_size       => cap_size,
+      cap_chunk      => cap_chunk,
       cap_en         => cap_en,
       cap_test       => cap_test,
+      cap_dense      => cap_dense,
+      cap_pkt        => cap_pkt,
+      trig_mode      => trig_mode,
+      trig_vpol      => trig_vpol,
+      trig_pre       => trig_pre,
+      trig_hdr       => trig_hdr,
+      trig_mask      => trig_mask,
+      win_en         => win_en,
+      win_hpol       => win_hpol,
+      win_vpol       => win_vpol,
+      win_line       => win_line,
+      win_pix        => win_pix,
+      win_skip       => win_skip,
+      cap_arm        => cap_arm,
       cap_run        => cap_run,
       cap_stop       => cap_stop,
       cap_loss       => cap_loss,
       cap_ovf        => cap_ovf,
       cap_unf        => cap_unf,
-      cap_count      => cap_count
+      cap_count      => cap_count,
+      cap_irq        => cap_irq,
+      vtm            => vtm,
+      crc            => crc,
+      crc_t          => crc_t
    );
 
   U_STREAM: component tmds_cap_stream
@@ -164,11 +211,28 @@ begin
       prst        => prst,
       pclk        => pclk,
       tmds        => tmds,
+      tmds_o      => tmds_d,
+      dec_o       => dec,
       tmds_lock   => tmds_lock,
       cap_rst     => cap_rst,
       cap_size    => cap_size,
+      cap_chunk   => cap_chunk,
       cap_en      => cap_en,
       cap_test    => cap_test,
+      cap_dense   => cap_dense,
+      cap_pkt     => cap_pkt,
+      trig_mode   => trig_mode,
+      trig_vpol   => trig_vpol,
+      trig_pre    => trig_pre,
+      trig_hdr    => trig_hdr,
+      trig_mask   => trig_mask,
+      win_en      => win_en,
+      win_hpol    => win_hpol,
+      win_vpol    => win_vpol,
+      win_line    => win_line,
+      win_pix     => win_pix,
+      win_skip    => win_skip,
+      cap_arm     => cap_arm,
       cap_run     => cap_run,
       cap_stop    => cap_stop,
       cap_loss    => cap_loss,
@@ -181,6 +245,30 @@ begin
       maxi4s_miso => maxi4s_miso
     );
 
+  U_VTM: component tmds_cap_vtm
+    port map (
+      rst  => prst,
+      clk  => pclk,
+      lock => tmds_lock,
+      tmds => tmds_d,
+      dec  => dec,
+      vtm  => vtm,
+      de   => vtm_de,
+      px   => vtm_px,
+      fs   => vtm_fs
+    );
+
+  U_CRC: component tmds_cap_crc
+    port map (
+      rst   => prst,
+      clk   => pclk,
+      de    => vtm_de,
+      px    => vtm_px,
+      fs    => vtm_fs,
+      crc   => crc,
+      crc_t => crc_t
+    );
+
   --------------------------------------------------------------------------------
   -- HDMI I/O
 
@@ -33,7 +33,9 @@ package tmds_cap_z7ps_pkg is
       maxi4_mosi  : out   axi4_a32d32_h_mosi_t;
       maxi4_miso  : in    axi4_a32d32_h_miso_t;
       saxi4s_mosi : in    axi4s_64_mosi_t;
-      saxi4s_miso : out   axi4s_64_miso_t
+      saxi4s_miso : out   axi4s_64_miso_t;
+
+      cap_irq     : in    std_logic
 
     );
   end component tmds_cap_z7ps;
@@ -58,7 +60,9 @@ entity tmds_cap_z7ps is
     maxi4_mosi  : out   axi4_a32d32_h_mosi_t;
     maxi4_miso  : in    axi4_a32d32_h_miso_t;
     saxi4s_mosi : in    axi4s_64_mosi_t;
-    saxi4s_miso : out   axi4s_64_miso_t
+    saxi4s_miso : out   axi4s_64_miso_t;
+
+    cap_irq     : in    std_logic
 
   );
 end entity tmds_cap_z7ps;
@@ -110,7 +114,9 @@ architecture wrapper of tmds_cap_z7ps is
       saxis64_tkeep  : in    std_logic_vector(  7 downto 0 );
       saxis64_tlast  : in    std_logic;
       saxis64_tvalid : in    std_logic;
-      saxis64_tready : out   std_logic
+      saxis64_tready : out   std_logic;
+
+      cap_irq        : in    std_logic
 
     );
   end component tmds_cap_z7ps_sys;
@@ -161,7 +167,9 @@ begin
       saxis64_tkeep    => saxi4s_mosi.tkeep,
       saxis64_tlast    => saxi4s_mosi.tlast,
       saxis64_tvalid   => saxi4s_mosi.tvalid,
-      saxis64_tready   => saxi4s_miso.tready
+      saxis64_tready   => saxi4s_miso.tready,
+
+      cap_irq          => cap_irq
 
     );
 